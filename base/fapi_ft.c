@@ -42,6 +42,13 @@
 
 #include "gxfapi.h"
 
+#include "gp.h"                 /* for the persistent glyph cache */
+#include "gsmd5.h"
+#include "gslibctx.h"
+#include "gscdefs.h"
+#include "gssprintf.h"
+#include "stdint_.h"
+#include <stdlib.h>             /* for qsort */
 
 /* FreeType headers */
 #include <ft2build.h>
@@ -65,6 +72,72 @@
 #define ft_emprintf(m,s) { outflush(m); emprintf(m, s); outflush(m); }
 #define ft_emprintf1(m,s,d) { outflush(m); emprintf1(m, s, d); outflush(m); }
 
+/* Persistent glyphs.  If the FAPIGlyphCacheDir user parameter names a
+ * directory, the bitmaps rendered by FreeType are also kept there, one file
+ * per "strike" (a face at one transform, size, resolution and hinting mode),
+ * and later runs map the file in rather than loading and rendering the
+ * glyphs again. Glyphs rendered during a run are added to the strike's file
+ * when the strike is dropped or the server is closed; the file is written
+ * under a private name and renamed, so concurrent runs can share the
+ * directory. A file whose header does not match is simply not used.
+ */
+#define FF_GLYPH_FILE_MAGIC "GSFTGLYF"
+#define FF_GLYPH_FILE_VERSION 1
+#define FF_GLYPH_STRIKES 8      /* strikes kept open at once */
+
+typedef struct ff_glyph_file_header_s
+{
+    char magic[8];
+    int32_t version;
+    int32_t revision;           /* gs_revision of the writer */
+    int32_t rec_size;           /* sizeof(ff_glyph_rec) of the writer */
+    byte strike[16];            /* md5 of the strike description */
+    uint32_t count;             /* number of ff_glyph_rec that follow */
+    uint32_t data_size;         /* size of the bitmaps after those */
+} ff_glyph_file_header;
+
+/* What the rendered glyph depends on, besides the strike. */
+typedef struct ff_glyph_key_s
+{
+    uint32_t index;             /* FreeType glyph index */
+    int32_t sb_x, sb_y, aw_x;   /* metrics supplied by the client */
+    int32_t flags;              /* metrics type, is_mtx_skipped, is_vertical */
+    byte program[8];            /* md5 of the glyph data, incremental faces */
+} ff_glyph_key;
+
+typedef struct ff_glyph_rec_s
+{
+    ff_glyph_key key;
+    gs_fapi_metrics metrics;
+    int32_t width, height, pitch, left, top;
+    uint32_t offset;            /* of the bitmap, from the end of the records */
+} ff_glyph_rec;
+
+typedef struct ff_new_glyph_s ff_new_glyph;
+struct ff_new_glyph_s
+{
+    ff_glyph_rec rec;
+    ff_new_glyph *next;
+    /* The bitmap follows. */
+};
+
+typedef struct ff_strike_s
+{
+    bool in_use;
+    byte key[16];
+    uint64_t stamp;             /* for replacement */
+    const byte *map;            /* the file, mapped */
+    size_t map_size;
+    byte *buffer;               /* the file, read if it couldn't be mapped */
+    const ff_glyph_rec *recs;   /* sorted by key */
+    uint count;
+    const byte *data;
+    uint32_t data_size;
+    ff_new_glyph *added;        /* rendered in this run, not yet in the file */
+    uint added_count;
+    uint32_t added_size;
+} ff_strike;
+
 typedef struct ff_server_s
 {
     gs_fapi_server fapi_server;
@@ -74,6 +147,14 @@ typedef struct ff_server_s
     gs_memory_t *mem;
     FT_Memory ftmemory;
     struct FT_MemoryRec_ ftmemory_rec;
+
+    /* Persistent glyphs, see above. */
+    ff_strike strikes[FF_GLYPH_STRIKES];
+    ff_strike *strike;          /* of the current scaled font, or NULL */
+    uint64_t strike_clock;
+    const ff_glyph_rec *cached_glyph;   /* found by the last load_glyph */
+    const byte *cached_bits;
+    int glyph_hits, glyph_misses, glyph_writes;
 } ff_server;
 
 
@@ -97,6 +178,10 @@ typedef struct ff_face_s
     int font_data_len;
     bool data_owned;
     ff_server *server;
+
+    /* md5 of the font data, for the persistent glyph cache */
+    byte font_hash[16];
+    bool font_hashed;
 } ff_face;
 
 /* Here we define the struct FT_Incremental that is used as an opaque type
@@ -292,6 +377,7 @@ new_face(gs_fapi_server * a_server, FT_Face a_ft_face,
         face->data_owned = data_owned;
         face->ftstrm = ftstrm;
         face->server = (ff_server *) a_server;
+        face->font_hashed = false;
     }
     return face;
 }
@@ -543,6 +629,397 @@ ft_to_gs_error(FT_Error a_error)
     return 0;
 }
 
+/* Returns false if there is no glyph cache directory */
+static bool
+ff_glyph_file_name(ff_server *s, const byte *key, char *fname, int len)
+{
+    const gs_lib_ctx_t *ctx = s->mem->gs_lib_ctx;
+    const char *sep = "";
+    char hex[33];
+    int i;
+
+    if (ctx->glyphcachedir == NULL || ctx->glyphcachedir_len == 0)
+        return false;
+    if (ctx->glyphcachedir[ctx->glyphcachedir_len - 1] != '/' &&
+        ctx->glyphcachedir[ctx->glyphcachedir_len - 1] != '\\')
+        sep = gp_file_name_directory_separator();
+    for (i = 0; i < 16; i++)
+        gs_snprintf(hex + 2 * i, 3, "%02x", key[i]);
+    return gs_snprintf(fname, len, "%s%sgsftg_%s.fgc", ctx->glyphcachedir,
+                       sep, hex) < len - 1;
+}
+
+/* Hash the whole of the font data that FreeType was given. */
+static bool
+ff_hash_face(ff_server *s, ff_face *face, gs_fapi_font *a_font)
+{
+    gs_md5_state_t md5;
+    int32_t id[3];
+
+    if (face->font_hashed)
+        return true;
+    id[0] = a_font->subfont;
+    id[1] = a_font->is_type1;
+    id[2] = a_font->is_cid;
+    gs_md5_init(&md5);
+    gs_md5_append(&md5, (const gs_md5_byte_t *)id, sizeof(id));
+    if (face->font_data != NULL && face->font_data_len > 0)
+        gs_md5_append(&md5, face->font_data, face->font_data_len);
+    else if (face->ftstrm != NULL) {
+        unsigned long pos, n;
+        byte *buf = gs_malloc(s->mem, 65536, 1, "ff_hash_face");
+
+        if (buf == NULL)
+            return false;
+        for (pos = 0; pos < face->ftstrm->size; pos += n) {
+            n = face->ftstrm->read(face->ftstrm, pos, buf, 65536);
+            if (n == 0 || n > 65536)
+                break;
+            gs_md5_append(&md5, buf, n);
+        }
+        gs_free(s->mem, buf, 0, 0, "ff_hash_face");
+        if (pos < face->ftstrm->size)
+            return false;
+    }
+    else
+        return false;
+    gs_md5_finish(&md5, face->font_hash);
+    face->font_hashed = true;
+    return true;
+}
+
+static int
+ff_glyph_key_compare(const void *a, const void *b)
+{
+    return memcmp(&((const ff_glyph_rec *)a)->key,
+                  &((const ff_glyph_rec *)b)->key, sizeof(ff_glyph_key));
+}
+
+/* Map in the strike's file, if there is a usable one. */
+static void
+ff_strike_load(ff_server *s, ff_strike *strike)
+{
+    char fname[gp_file_name_sizeof];
+    ff_glyph_file_header header;
+    gp_file *fid;
+    gs_offset_t size = 0;
+    const byte *file;
+    uint i;
+
+    if (!ff_glyph_file_name(s, strike->key, fname, sizeof(fname)))
+        return;
+    fid = gp_fopen_unchecked(s->mem, fname, "rb");
+    if (fid == NULL)
+        return;
+    if (gp_fread(&header, 1, sizeof(header), fid) == sizeof(header) &&
+        memcmp(header.magic, FF_GLYPH_FILE_MAGIC, sizeof(header.magic)) == 0 &&
+        header.version == FF_GLYPH_FILE_VERSION &&
+        header.revision == gs_revision &&
+        header.rec_size == sizeof(ff_glyph_rec) &&
+        memcmp(header.strike, strike->key, sizeof(header.strike)) == 0 &&
+        header.count < max_uint / sizeof(ff_glyph_rec) &&
+        gp_fseek(fid, 0, SEEK_END) == 0) {
+        size = gp_ftell(fid);
+        if (size == sizeof(header) + (gs_offset_t)header.count * sizeof(ff_glyph_rec)
+                   + header.data_size) {
+            strike->map = gp_fmap(fid, size);
+            if (strike->map == NULL) {
+                strike->buffer = gs_malloc(s->mem, size, 1, "ff_strike_load");
+                if (strike->buffer != NULL &&
+                    (gp_fseek(fid, 0, SEEK_SET) != 0 ||
+                     gp_fread(strike->buffer, 1, size, fid) != size)) {
+                    gs_free(s->mem, strike->buffer, 0, 0, "ff_strike_load");
+                    strike->buffer = NULL;
+                }
+            }
+            else
+                strike->map_size = size;
+        }
+    }
+    gp_fclose(fid);
+    file = (strike->map != NULL ? strike->map : strike->buffer);
+    if (file == NULL)
+        return;
+    strike->recs = (const ff_glyph_rec *)(file + sizeof(header));
+    strike->count = header.count;
+    strike->data = file + sizeof(header) + header.count * sizeof(ff_glyph_rec);
+    strike->data_size = header.data_size;
+    /* Don't trust a damaged file: the bitmap must lie within the data, each
+     * row must hold the width, and the origin is scaled by 16 for the
+     * raster (see get_char_raster). */
+    for (i = 0; i < strike->count; i++) {
+        const ff_glyph_rec *rec = &strike->recs[i];
+
+        if (rec->pitch <= 0 || rec->height < 0 ||
+            rec->width < 0 || (int64_t)rec->pitch * 8 < rec->width ||
+            rec->left > max_int / 16 || rec->left < min_int / 16 ||
+            rec->top > max_int / 16 || rec->top < min_int / 16 ||
+            rec->offset > strike->data_size ||
+            (strike->data_size - rec->offset) / rec->pitch < (uint32_t)rec->height) {
+            strike->count = 0;
+            break;
+        }
+    }
+    if_debug2m('m', s->mem, "[m]FAPI glyph cache: %u glyphs from %s\n",
+               strike->count, fname);
+}
+
+/* Write the strike's file again if glyphs were added to it. */
+static void
+ff_strike_store(ff_server *s, ff_strike *strike)
+{
+    char fname[gp_file_name_sizeof];
+    char tmpname[gp_file_name_sizeof];
+    ff_glyph_file_header header;
+    ff_glyph_rec *recs;
+    ff_new_glyph *g;
+    uint count = strike->count + strike->added_count;
+    uint32_t offset = strike->data_size;
+    gp_file *fid;
+    long now[2];
+    uint i;
+    bool ok;
+
+    if (!ff_glyph_file_name(s, strike->key, fname, sizeof(fname)))
+        return;
+    gp_get_realtime(now);
+    if (gs_snprintf(tmpname, sizeof(tmpname), "%s.%lx%lx", fname, now[1],
+                    (long)(intptr_t)strike) >= (int)sizeof(tmpname) - 1)
+        return;
+    if (strike->data_size > max_uint - strike->added_size)
+        return;
+    recs = gs_malloc(s->mem, count, sizeof(ff_glyph_rec), "ff_strike_store");
+    if (recs == NULL)
+        return;
+    if (strike->count > 0)
+        memcpy(recs, strike->recs, strike->count * sizeof(ff_glyph_rec));
+    for (i = strike->count, g = strike->added; g != NULL; g = g->next, i++) {
+        recs[i] = g->rec;
+        recs[i].offset = offset;
+        offset += g->rec.height * g->rec.pitch;
+    }
+    qsort(recs, count, sizeof(ff_glyph_rec), ff_glyph_key_compare);
+
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, FF_GLYPH_FILE_MAGIC, sizeof(header.magic));
+    header.version = FF_GLYPH_FILE_VERSION;
+    header.revision = gs_revision;
+    header.rec_size = sizeof(ff_glyph_rec);
+    memcpy(header.strike, strike->key, sizeof(header.strike));
+    header.count = count;
+    header.data_size = offset;
+    fid = gp_fopen_unchecked(s->mem, tmpname, "wb");
+    if (fid != NULL) {
+        ok = gp_fwrite(&header, 1, sizeof(header), fid) == sizeof(header) &&
+             gp_fwrite(recs, sizeof(ff_glyph_rec), count, fid) == count &&
+             gp_fwrite(strike->data, 1, strike->data_size, fid) == strike->data_size;
+        for (g = strike->added; ok && g != NULL; g = g->next) {
+            size_t len = g->rec.height * g->rec.pitch;
+
+            ok = gp_fwrite(g + 1, 1, len, fid) == len;
+        }
+        ok = (gp_fclose(fid) == 0) && ok;
+        if (ok && gp_rename_unchecked(s->mem, tmpname, fname) == 0) {
+            s->glyph_writes++;
+            if_debug2m('m', s->mem, "[m]FAPI glyph cache: %u glyphs to %s\n",
+                       count, fname);
+        }
+        else
+            gp_unlink_unchecked(s->mem, tmpname);
+    }
+    gs_free(s->mem, recs, 0, 0, "ff_strike_store");
+}
+
+static void
+ff_strike_release(ff_server *s, ff_strike *strike)
+{
+    ff_new_glyph *g, *next;
+
+    if (!strike->in_use)
+        return;
+    if (strike->added != NULL)
+        ff_strike_store(s, strike);
+    for (g = strike->added; g != NULL; g = next) {
+        next = g->next;
+        gs_free(s->mem, g, 0, 0, "ff_strike_release");
+    }
+    if (strike->map != NULL)
+        gp_funmap(strike->map, strike->map_size);
+    if (strike->buffer != NULL)
+        gs_free(s->mem, strike->buffer, 0, 0, "ff_strike_release");
+    memset(strike, 0, sizeof(*strike));
+    if (s->strike == strike)
+        s->strike = NULL;
+}
+
+/* Find the strike for the face at its current scale, opening it if this
+ * run hasn't used it yet.
+ */
+static void
+ff_strike_select(ff_server *s, ff_face *face, gs_fapi_font *a_font)
+{
+    gs_md5_state_t md5;
+    int32_t desc[14];
+    byte key[16];
+    ff_strike *strike = NULL;
+    int i;
+
+    s->strike = NULL;
+    if (s->mem->gs_lib_ctx->glyphcachedir == NULL)
+        return;
+    /* The glyphs of a multiple master font depend on its weight vector. */
+    if (FT_HAS_MULTIPLE_MASTERS(face->ft_face) ||
+        !ff_hash_face(s, face, a_font))
+        return;
+    desc[0] = (int32_t)face->ft_transform.xx;
+    desc[1] = (int32_t)face->ft_transform.xy;
+    desc[2] = (int32_t)face->ft_transform.yx;
+    desc[3] = (int32_t)face->ft_transform.yy;
+    desc[4] = (int32_t)face->width;
+    desc[5] = (int32_t)face->height;
+    desc[6] = face->horz_res;
+    desc[7] = face->vert_res;
+    desc[8] = s->fapi_server.grid_fit;
+    desc[9] = a_font->is_type1;
+    desc[10] = FREETYPE_MAJOR;
+    desc[11] = FREETYPE_MINOR;
+    desc[12] = FREETYPE_PATCH;
+    desc[13] = 0;
+    gs_md5_init(&md5);
+    gs_md5_append(&md5, face->font_hash, sizeof(face->font_hash));
+    gs_md5_append(&md5, (const gs_md5_byte_t *)desc, sizeof(desc));
+    gs_md5_finish(&md5, key);
+
+    for (i = 0; i < FF_GLYPH_STRIKES; i++) {
+        if (s->strikes[i].in_use &&
+            memcmp(s->strikes[i].key, key, sizeof(key)) == 0) {
+            strike = &s->strikes[i];
+            break;
+        }
+        if (strike == NULL || !s->strikes[i].in_use ||
+            (strike->in_use && s->strikes[i].stamp < strike->stamp))
+            strike = &s->strikes[i];
+    }
+    if (!strike->in_use || memcmp(strike->key, key, sizeof(key)) != 0) {
+        ff_strike_release(s, strike);
+        strike->in_use = true;
+        memcpy(strike->key, key, sizeof(key));
+        ff_strike_load(s, strike);
+    }
+    strike->stamp = ++s->strike_clock;
+    s->strike = strike;
+}
+
+/* Work out what the glyph about to be loaded depends on. For incremental
+ * faces that includes the glyph data the client will supply, which isn't
+ * part of the face's hash. Returns false if the glyph can't be cached.
+ */
+static bool
+ff_glyph_key_make(ff_server *s, ff_face *face, gs_fapi_font *a_fapi_font,
+                  const gs_fapi_char_ref *a_char_ref, int index,
+                  ff_glyph_key *key)
+{
+    memset(key, 0, sizeof(*key));
+    key->index = index;
+    key->sb_x = a_char_ref->sb_x;
+    key->sb_y = a_char_ref->sb_y;
+    key->aw_x = a_char_ref->aw_x;
+    key->flags = a_char_ref->metrics_type | (a_fapi_font->is_mtx_skipped << 8) |
+                 (a_fapi_font->is_vertical << 9);
+    if (face->ft_inc_int) {
+        const void *saved_char_data = a_fapi_font->char_data;
+        const int saved_char_data_len = a_fapi_font->char_data_len;
+        gs_md5_state_t md5;
+        byte digest[16];
+        byte *buf;
+        int length;
+
+        a_fapi_font->need_decrypt = true;
+        length = a_fapi_font->get_glyph(a_fapi_font, index, NULL, 0);
+        if (length < 0)
+            return false;
+        buf = gs_malloc(s->mem, length + 1, 1, "ff_glyph_key_make");
+        if (buf == NULL)
+            return false;
+        length = a_fapi_font->get_glyph(a_fapi_font, index, buf, length);
+        a_fapi_font->char_data = saved_char_data;
+        a_fapi_font->char_data_len = saved_char_data_len;
+        if (length >= 0) {
+            gs_md5_init(&md5);
+            gs_md5_append(&md5, buf, length);
+            gs_md5_finish(&md5, digest);
+            memcpy(key->program, digest, sizeof(key->program));
+        }
+        gs_free(s->mem, buf, 0, 0, "ff_glyph_key_make");
+        if (length < 0)
+            return false;
+    }
+    return true;
+}
+
+static bool
+ff_glyph_find(ff_server *s, const ff_glyph_key *key)
+{
+    ff_strike *strike = s->strike;
+    ff_new_glyph *g;
+    size_t lo = 0, hi = strike->count;
+
+    while (lo < hi) {
+        size_t mid = (lo + hi) / 2;
+        int c = memcmp(key, &strike->recs[mid].key, sizeof(*key));
+
+        if (c == 0) {
+            s->cached_glyph = &strike->recs[mid];
+            s->cached_bits = strike->data + strike->recs[mid].offset;
+            return true;
+        }
+        if (c < 0)
+            hi = mid;
+        else
+            lo = mid + 1;
+    }
+    for (g = strike->added; g != NULL; g = g->next) {
+        if (memcmp(key, &g->rec.key, sizeof(*key)) == 0) {
+            s->cached_glyph = &g->rec;
+            s->cached_bits = (const byte *)(g + 1);
+            return true;
+        }
+    }
+    return false;
+}
+
+/* Remember a newly rendered glyph, to be written with the strike. */
+static void
+ff_glyph_add(ff_server *s, const ff_glyph_key *key,
+             const gs_fapi_metrics *metrics, FT_BitmapGlyph bitmap_glyph)
+{
+    ff_strike *strike = s->strike;
+    const FT_Bitmap *bitmap = &bitmap_glyph->bitmap;
+    uint32_t len = bitmap->rows * bitmap->pitch;
+    ff_new_glyph *g;
+
+    if (bitmap_glyph->root.format != FT_GLYPH_FORMAT_BITMAP ||
+        bitmap->pitch <= 0 || len > max_uint - strike->added_size)
+        return;
+    g = gs_malloc(s->mem, sizeof(ff_new_glyph) + len, 1, "ff_glyph_add");
+    if (g == NULL)
+        return;
+    memset(&g->rec, 0, sizeof(g->rec));
+    g->rec.key = *key;
+    g->rec.metrics = *metrics;
+    g->rec.width = bitmap->width;
+    g->rec.height = bitmap->rows;
+    g->rec.pitch = bitmap->pitch;
+    g->rec.left = bitmap_glyph->left;
+    g->rec.top = bitmap_glyph->top;
+    if (len > 0)
+        memcpy(g + 1, bitmap->buffer, len);
+    g->next = strike->added;
+    strike->added = g;
+    strike->added_count++;
+    strike->added_size += len;
+}
+
 /* Load a glyph and optionally rasterize it. Return its metrics in a_metrics.
  * If a_bitmap is true convert the glyph to a bitmap.
  */
@@ -562,6 +1039,8 @@ load_glyph(gs_fapi_server * a_server, gs_fapi_font * a_fapi_font,
     FT_Long fflags;
     FT_Int32 load_flags = 0;
     FT_Vector  delta = {0,0};
+    ff_glyph_key key;
+    bool cache_glyph = false;
 
     /* Save a_fapi_font->char_data, which is set to null by FAPI_FF_get_glyph as part of a hack to
      * make the deprecated Type 2 endchar ('seac') work, so that it can be restored
@@ -580,6 +1059,7 @@ load_glyph(gs_fapi_server * a_server, gs_fapi_font * a_fapi_font,
         FF_free(s->ftmemory, s->outline_glyph);
         s->outline_glyph = NULL;
     }
+    s->cached_glyph = NULL;
 
     if (!a_char_ref->is_glyph_index) {
         if (ft_face->num_charmaps)
@@ -658,6 +1138,21 @@ load_glyph(gs_fapi_server * a_server, gs_fapi_font * a_fapi_font,
         /* Make sure we don't leave this set to the last value, as we may then use inappropriate metrics values */
         face->ft_inc_int->object->glyph_metrics_index = 0xFFFFFFFF;
 
+    /* Look for the rendered glyph in the persistent glyph cache. */
+    if (s->strike != NULL && a_bitmap && a_metrics != NULL &&
+        !a_fapi_font->metrics_only &&
+        ff_glyph_key_make(s, face, a_fapi_font, a_char_ref, index, &key)) {
+        if (ff_glyph_find(s, &key) &&
+            s->cached_glyph->height * s->cached_glyph->pitch < max_bitmap) {
+            s->glyph_hits++;
+            *a_metrics = s->cached_glyph->metrics;
+            return 0;
+        }
+        s->cached_glyph = NULL;
+        s->glyph_misses++;
+        cache_glyph = true;
+    }
+
     /* We have to load the glyph, scale it correctly, and render it if we need a bitmap. */
     if (!ft_error) {
         /* We disable loading bitmaps because if we allow it then FreeType invents metrics for them, which messes up our glyph positioning */
@@ -834,6 +1329,8 @@ load_glyph(gs_fapi_server * a_server, gs_fapi_font * a_fapi_font,
         ft_face->glyph->advance.x = ft_face->glyph->advance.y = 0;
         if ((!ft_error || !ft_error_fb) && a_glyph) {
             ft_error = FT_Get_Glyph(ft_face->glyph, a_glyph);
+            if (!ft_error && cache_glyph)
+                ff_glyph_add(s, &key, a_metrics, (FT_BitmapGlyph)*a_glyph);
         }
         else {
             if (ft_face->glyph->format == FT_GLYPH_FORMAT_BITMAP) {
@@ -1148,6 +1645,8 @@ gs_fapi_ft_get_scaled_font(gs_fapi_server * a_server, gs_fapi_font * a_font,
         FF_free(s->ftmemory, s->outline_glyph);
         s->outline_glyph = NULL;
     }
+    s->cached_glyph = NULL;
+    s->strike = NULL;
 
     /* dpf("gs_fapi_ft_get_scaled_font enter: is_type1=%d is_cid=%d font_file_path='%s' a_descendant_code=%d\n",
        a_font->is_type1, a_font->is_cid, a_font->font_file_path ? a_font->font_file_path : "", a_descendant_code); */
@@ -1447,6 +1946,7 @@ gs_fapi_ft_get_scaled_font(gs_fapi_server * a_server, gs_fapi_font * a_font,
 
         FT_Set_Transform(face->ft_face, &face->ft_transform, NULL);
 
+        ff_strike_select(s, face, a_font);
     }
 
     /* dpf("gs_fapi_ft_get_scaled_font return %d\n", a_font->server_font_data ? 0 : -1); */
@@ -1588,6 +2088,17 @@ gs_fapi_ft_get_char_raster(gs_fapi_server * a_server, gs_fapi_raster * a_raster)
 {
     ff_server *s = (ff_server *) a_server;
 
+    if (s->cached_glyph) {
+        a_raster->p = (void *)s->cached_bits;
+        a_raster->width = s->cached_glyph->width;
+        a_raster->height = s->cached_glyph->height;
+        a_raster->line_step = s->cached_glyph->pitch;
+        a_raster->orig_x = s->cached_glyph->left * 16;
+        a_raster->orig_y = s->cached_glyph->top * 16;
+        a_raster->left_indent = a_raster->top_indent = a_raster->black_height =
+            a_raster->black_width = 0;
+        return 0;
+    }
     if (!s->bitmap_glyph)
         return(gs_error_unregistered);
     a_raster->p = s->bitmap_glyph->bitmap.buffer;
@@ -1808,6 +2319,7 @@ gs_fapi_ft_release_char_data(gs_fapi_server * a_server)
 
     s->outline_glyph = NULL;
     s->bitmap_glyph = NULL;
+    s->cached_glyph = NULL;
     return 0;
 }
 
@@ -1943,6 +2455,13 @@ gs_fapi_freetype_destroy(gs_fapi_server ** serv)
 {
     ff_server *server = (ff_server *) * serv;
     gs_memory_t *cmem = server->mem;
+    int i;
+
+    for (i = 0; i < FF_GLYPH_STRIKES; i++)
+        ff_strike_release(server, &server->strikes[i]);
+    if (server->glyph_hits + server->glyph_misses > 0)
+        if_debug3m('m', cmem, "[m]FAPI glyph cache: %d hits, %d misses, %d files written\n",
+                   server->glyph_hits, server->glyph_misses, server->glyph_writes);
 
     FT_Done_Glyph(&server->outline_glyph->root);
     FT_Done_Glyph(&server->bitmap_glyph->root);
@@ -71,6 +71,9 @@ static void prn_print_page_in_background(void *data);
 
 /* wait for a background thread to finish and clean up background printing */
 static void prn_finish_bg_print(gx_device_printer *ppdev);
+static void prn_finish_bg_print_page(gx_device_printer *ppdev, bg_print_t *bg_print);
+static void prn_free_bg_print_sync(gx_device_printer *ppdev);
+static int prn_bg_print_make_room(gx_device_printer *ppdev, int max_pages, size_t size);
 
 /* ------ Open/close ------ */
 /* Open a generic printer device. */
@@ -109,51 +112,185 @@ gdev_prn_open(gx_device * pdev)
     return code;
 }
 
-/* This is called various places to wait for any pending bg print thread and */
-/* perform its cleanup                                                       */
+/* Wait for one background printing thread to finish and perform its cleanup */
 static void
-prn_finish_bg_print(gx_device_printer *ppdev)
+prn_finish_bg_print_page(gx_device_printer *ppdev, bg_print_t *bg_print)
 {
     /* if we have a a bg printing device that was created, then wait for its	*/
     /* semaphore (it may already have been signalled, but that's OK.) then	*/
     /* close and unlink the files and free the device and its private allocator	*/
-    if (ppdev->bg_print && (ppdev->bg_print->device != NULL)) {
+    if (bg_print->device != NULL) {
         int closecode;
-        gx_device_printer *bgppdev = (gx_device_printer *)ppdev->bg_print->device;
+        gx_device_printer *bgppdev = (gx_device_printer *)bg_print->device;
+        gp_file *save_file = ppdev->file;
 
-        gx_semaphore_wait(ppdev->bg_print->sema);
+        gx_semaphore_wait(bg_print->sema);
         /* If numcopies > 1, then the bg_print->device will have closed and reopened
          * the output file, so the pointer in the original device is now stale,
          * so copy it back.
          * If numcopies == 1, this is pointless, but benign.
+         * With a file per page, the foreground may already have opened the file
+         * for a later page, so keep that one.
          */
         ppdev->file = bgppdev->file;
         closecode = gdev_prn_close_printer((gx_device *)ppdev);
-        if (ppdev->bg_print->return_code == 0)
-            ppdev->bg_print->return_code = closecode;	/* return code here iff there wasn't another error */
-        teardown_device_and_mem_for_thread(ppdev->bg_print->device,
-                                           ppdev->bg_print->thread_id, true);
-        ppdev->bg_print->device = NULL;
-        if (ppdev->bg_print->ocfile) {
-            closecode = ppdev->bg_print->oio_procs->fclose(ppdev->bg_print->ocfile, ppdev->bg_print->ocfname, true);
-            if (ppdev->bg_print->return_code == 0)
-               ppdev->bg_print->return_code = closecode;
+        if (save_file != NULL && save_file != bgppdev->file)
+            ppdev->file = save_file;
+        if (bg_print->return_code == 0)
+            bg_print->return_code = closecode;	/* return code here iff there wasn't another error */
+        teardown_device_and_mem_for_thread(bg_print->device,
+                                           bg_print->thread_id, true);
+        bg_print->device = NULL;
+        if (bg_print->ocfile) {
+            closecode = bg_print->oio_procs->fclose(bg_print->ocfile, bg_print->ocfname, true);
+            if (bg_print->return_code == 0)
+               bg_print->return_code = closecode;
         }
-        if (ppdev->bg_print->ocfname) {
-            gs_free_object(ppdev->memory->non_gc_memory, ppdev->bg_print->ocfname, "prn_finish_bg_print(ocfname)");
+        if (bg_print->ocfname) {
+            gs_free_object(ppdev->memory->non_gc_memory, bg_print->ocfname, "prn_finish_bg_print(ocfname)");
         }
-        if (ppdev->bg_print->obfile) {
-            closecode = ppdev->bg_print->oio_procs->fclose(ppdev->bg_print->obfile, ppdev->bg_print->obfname, true);
-            if (ppdev->bg_print->return_code == 0)
-               ppdev->bg_print->return_code = closecode;
+        if (bg_print->obfile) {
+            closecode = bg_print->oio_procs->fclose(bg_print->obfile, bg_print->obfname, true);
+            if (bg_print->return_code == 0)
+               bg_print->return_code = closecode;
         }
-        if (ppdev->bg_print->obfname) {
-            gs_free_object(ppdev->memory->non_gc_memory, ppdev->bg_print->obfname, "prn_finish_bg_print(obfname)");
+        if (bg_print->obfname) {
+            gs_free_object(ppdev->memory->non_gc_memory, bg_print->obfname, "prn_finish_bg_print(obfname)");
         }
-        ppdev->bg_print->ocfile = ppdev->bg_print->obfile =
-          ppdev->bg_print->ocfname = ppdev->bg_print->obfname = NULL;
+        bg_print->ocfile = bg_print->obfile =
+          bg_print->ocfname = bg_print->obfname = NULL;
+    }
+}
+
+/* Free the semaphores used for background printing. All of the */
+/* background pages must have been finished.                     */
+static void
+prn_free_bg_print_sync(gx_device_printer *ppdev)
+{
+    int i;
+
+    if (ppdev->bg_print == NULL)
+        return;
+    for (i = 0; i < BG_PRINT_MAX_DEPTH; i++) {
+        gx_semaphore_free(ppdev->bg_print[i].sema);
+        ppdev->bg_print[i].sema = NULL;		/* prevent double free */
     }
 }
+
+/* Return the oldest page printing in the background, or NULL if none */
+static bg_print_t *
+prn_oldest_bg_print(gx_device_printer *ppdev)
+{
+    bg_print_t *oldest = NULL;
+    int i;
+
+    if (ppdev->bg_print == NULL)
+        return NULL;
+    for (i = 0; i < BG_PRINT_MAX_DEPTH; i++) {
+        bg_print_t *bg_print = &ppdev->bg_print[i];
+
+        if (bg_print->device != NULL && (oldest == NULL || bg_print->order < oldest->order))
+            oldest = bg_print;
+    }
+    return oldest;
+}
+
+/* Return true if the output file name makes a separate file for each page */
+static bool
+prn_file_per_page(gx_device_printer *ppdev)
+{
+    gs_parsed_file_name_t parsed;
+    const char *fmt;
+    int code = gx_parse_output_file_name(&parsed, &fmt, ppdev->fname,
+                                         strlen(ppdev->fname), ppdev->memory);
+
+    return code >= 0 && fmt != NULL;
+}
+
+/* Return the page most recently started in the background, or NULL if none */
+static bg_print_t *
+prn_newest_bg_print(gx_device_printer *ppdev)
+{
+    bg_print_t *newest = NULL;
+    int i;
+
+    if (ppdev->bg_print == NULL)
+        return NULL;
+    for (i = 0; i < BG_PRINT_MAX_DEPTH; i++) {
+        bg_print_t *bg_print = &ppdev->bg_print[i];
+
+        if (bg_print->device != NULL && (newest == NULL || bg_print->order > newest->order))
+            newest = bg_print;
+    }
+    return newest;
+}
+
+/* Estimate the memory held by a page printing in the background: the */
+/* band buffers of its device and rendering threads, and the band list */
+/* if that is kept in memory.                                          */
+static size_t
+prn_bg_print_page_size(gx_device_printer *ppdev, int num_threads)
+{
+    gx_device_clist_reader *crdev = (gx_device_clist_reader *)ppdev;
+    const clist_io_procs_t *io_procs = crdev->page_info.io_procs;
+    size_t size = ppdev->buffer_space * (1 + num_threads);
+
+    if (io_procs == ppdev->memory->gs_lib_ctx->core->clist_io_procs_memory) {
+        size += crdev->page_info.bfile_end_pos;
+        if (crdev->page_info.cfile != NULL) {
+            int64_t pos = io_procs->ftell(crdev->page_info.cfile);
+
+            if (io_procs->fseek(crdev->page_info.cfile, 0, SEEK_END, crdev->page_info.cfname) >= 0) {
+                size += io_procs->ftell(crdev->page_info.cfile);
+                io_procs->fseek(crdev->page_info.cfile, pos, SEEK_SET, crdev->page_info.cfname);
+            }
+        }
+    }
+    return size;
+}
+
+/* This is called various places to wait for all the pending bg print */
+/* threads and perform their cleanup, in page order                   */
+static void
+prn_finish_bg_print(gx_device_printer *ppdev)
+{
+    bg_print_t *bg_print;
+
+    while ((bg_print = prn_oldest_bg_print(ppdev)) != NULL)
+        prn_finish_bg_print_page(ppdev, bg_print);
+}
+
+/* Finish background pages, oldest first, until fewer than max_pages are */
+/* left and another page of 'size' bytes fits within BGPrintMaxMemory.   */
+/* This is what holds the interpreter back when rendering can't keep up. */
+/* Returns the first error from the pages that were finished.            */
+static int
+prn_bg_print_make_room(gx_device_printer *ppdev, int max_pages, size_t size)
+{
+    int code = 0;
+
+    for (;;) {
+        bg_print_t *oldest = prn_oldest_bg_print(ppdev);
+        size_t used = 0;
+        int i, count = 0;
+
+        if (oldest == NULL)
+            break;
+        for (i = 0; i < BG_PRINT_MAX_DEPTH; i++) {
+            if (ppdev->bg_print[i].device != NULL) {
+                used += ppdev->bg_print[i].size;
+                count++;
+            }
+        }
+        if (count < max_pages &&
+            (ppdev->bg_print_max_memory == 0 || used + size <= ppdev->bg_print_max_memory))
+            break;
+        prn_finish_bg_print_page(ppdev, oldest);
+        if (code == 0 && oldest->return_code < 0)
+            code = oldest->return_code;
+    }
+    return code;
+}
 /* Generic closing for the printer device. */
 /* Specific devices may wish to extend this. */
 int
@@ -163,10 +300,6 @@ gdev_prn_close(gx_device * pdev)
     int code = 0;
 
     prn_finish_bg_print(ppdev);
-    if (ppdev->bg_print != NULL && ppdev->bg_print->sema != NULL) {
-        gx_semaphore_free(ppdev->bg_print->sema);
-        ppdev->bg_print->sema = NULL;		/* prevent double free */
-    }
     gdev_prn_free_memory(pdev);
     if (ppdev->file != NULL) {
         code = gx_device_close_output_file(pdev, ppdev->fname, ppdev->file);
@@ -292,11 +425,14 @@ gdev_prn_allocate(gx_device *pdev, gdev_space_params *new_space_params,
 
     /* bg_print allocation is not fatal, we just continue (as far as possible) without BGPrint */
     if (ppdev->bg_print == NULL)
-        ppdev->bg_print = (bg_print_t *)gs_alloc_bytes(pdev->memory->non_gc_memory, sizeof(bg_print_t), "prn bg_print");
+        ppdev->bg_print = (bg_print_t *)gs_alloc_byte_array(pdev->memory->non_gc_memory, BG_PRINT_MAX_DEPTH,
+                                                            sizeof(bg_print_t), "prn bg_print");
+    else
+        prn_free_bg_print_sync(ppdev);	/* we are reusing it, the pages are finished */
     if (ppdev->bg_print == NULL) {
         emprintf(pdev->memory, "Failed to allocate memory for BGPrint, attempting to continue without BGPrint\n");
     } else {
-        memset(ppdev->bg_print, 0, sizeof(bg_print_t));
+        memset(ppdev->bg_print, 0, BG_PRINT_MAX_DEPTH * sizeof(bg_print_t));
     }
 
     /* Re/allocate memory */
@@ -545,6 +681,7 @@ gdev_prn_free_memory(gx_device *pdev)
          ppdev->buffer_memory);
 
     gdev_prn_tear_down(pdev, &the_memory);
+    prn_free_bg_print_sync(ppdev);
     gs_free_object(pdev->memory->non_gc_memory, ppdev->bg_print, "gdev_prn_free_memory");
     ppdev->bg_print = NULL;
     gs_free_object(buffer_memory, the_memory, "gdev_prn_free_memory");
@@ -584,12 +721,21 @@ gdev_prn_get_param(gx_device *dev, char *Param, void *list)
     if (strcmp(Param, "NumRenderingThreads") == 0) {
         return param_write_int(plist, "NumRenderingThreads", &ppdev->num_render_threads_requested);
     }
+    if (strcmp(Param, "AdaptiveBanding") == 0) {
+        return param_write_bool(plist, "AdaptiveBanding", &ppdev->adaptive_banding_requested);
+    }
     if (strcmp(Param, "OpenOutputFile") == 0) {
         return param_write_bool(plist, "OpenOutputFile", &ppdev->OpenOutputFile);
     }
     if (strcmp(Param, "BGPrint") == 0) {
         return param_write_bool(plist, "BGPrint", &ppdev->bg_print_requested);
     }
+    if (strcmp(Param, "BGPrintDepth") == 0) {
+        return param_write_int(plist, "BGPrintDepth", &ppdev->bg_print_depth);
+    }
+    if (strcmp(Param, "BGPrintMaxMemory") == 0) {
+        return param_write_size_t(plist, "BGPrintMaxMemory", &ppdev->bg_print_max_memory);
+    }
     if (strcmp(Param, "ReopenPerPage") == 0) {
         return param_write_bool(plist, "ReopenPerPage", &ppdev->ReopenPerPage);
     }
@@ -655,8 +801,11 @@ gdev_prn_get_params(gx_device * pdev, gs_param_list * plist)
                   param_write_bool(plist, "Duplex", &ppdev->Duplex) :
                   param_write_null(plist, "Duplex"))) < 0) ||
         (code = param_write_int(plist, "NumRenderingThreads", &ppdev->num_render_threads_requested)) < 0 ||
+        (code = param_write_bool(plist, "AdaptiveBanding", &ppdev->adaptive_banding_requested)) < 0 ||
         (code = param_write_bool(plist, "OpenOutputFile", &ppdev->OpenOutputFile)) < 0 ||
         (code = param_write_bool(plist, "BGPrint", &ppdev->bg_print_requested)) < 0 ||
+        (code = param_write_int(plist, "BGPrintDepth", &ppdev->bg_print_depth)) < 0 ||
+        (code = param_write_size_t(plist, "BGPrintMaxMemory", &ppdev->bg_print_max_memory)) < 0 ||
         (code = param_write_bool(plist, "ReopenPerPage", &ppdev->ReopenPerPage)) < 0 ||
         (code = param_write_bool(plist, "pageneutralcolor", &pageneutralcolor)) < 0
         )
@@ -715,11 +864,14 @@ gdev_prn_put_params(gx_device * pdev, gs_param_list * plist)
     bool rpp = ppdev->ReopenPerPage;
     bool old_page_uses_transparency = ppdev->page_uses_transparency;
     bool bg_print_requested = ppdev->bg_print_requested;
+    int bg_print_depth = ppdev->bg_print_depth;
+    size_t bg_print_max_memory = ppdev->bg_print_max_memory;
     bool duplex;
     int duplex_set = -1;
     int width = pdev->width;
     int height = pdev->height;
     int nthreads = ppdev->num_render_threads_requested;
+    bool adaptive_banding = ppdev->adaptive_banding_requested;
     gdev_space_params save_sp;
     gs_param_string ofs;
     gs_param_string bls;
@@ -829,6 +981,15 @@ gdev_prn_put_params(gx_device * pdev, gs_param_list * plist)
         case 1:
             ;
     }
+    switch (code = param_read_bool(plist, (param_name = "AdaptiveBanding"),
+                                                        &adaptive_banding)) {
+        default:
+            ecode = code;
+            param_signal_error(plist, param_name, ecode);
+        case 0:
+        case 1:
+            break;
+    }
     switch (code = param_read_bool(plist, (param_name = "BGPrint"),
                                                         &bg_print_requested)) {
         default:
@@ -838,6 +999,28 @@ gdev_prn_put_params(gx_device * pdev, gs_param_list * plist)
         case 1:
             break;
     }
+    switch (code = param_read_int(plist, (param_name = "BGPrintDepth"), &bg_print_depth)) {
+        case 0:
+            if (bg_print_depth > BG_PRINT_MAX_DEPTH)
+                bg_print_depth = BG_PRINT_MAX_DEPTH;
+            if (bg_print_depth >= 1)
+                break;
+            code = gs_note_error(gs_error_rangecheck);
+        default:
+            ecode = code;
+            param_signal_error(plist, param_name, ecode);
+        case 1:
+            ;
+    }
+    switch (code = param_read_size_t(plist, (param_name = "BGPrintMaxMemory"),
+                                                        &bg_print_max_memory)) {
+        default:
+            ecode = code;
+            param_signal_error(plist, param_name, ecode);
+        case 0:
+        case 1:
+            break;
+    }
 
     switch (code = param_read_string(plist, (param_name = "saved-pages"),
                                                         &saved_pages)) {
@@ -877,11 +1060,14 @@ gdev_prn_put_params(gx_device * pdev, gs_param_list * plist)
     }
 
     ppdev->bg_print_requested = bg_print_requested;
+    ppdev->bg_print_depth = bg_print_depth;
+    ppdev->bg_print_max_memory = bg_print_max_memory;
     if (duplex_set >= 0) {
         ppdev->Duplex = duplex;
         ppdev->Duplex_set = duplex_set;
     }
     ppdev->num_render_threads_requested = nthreads;
+    ppdev->adaptive_banding_requested = adaptive_banding;
     if (bls.data != 0) {
         ppdev->BLS_force_memory = (bls.data[0] == 'm');
     }
@@ -949,9 +1135,21 @@ gdev_prn_output_page_aux(gx_device * pdev, int num_copies, int flush, bool seeka
     gx_device_printer * const ppdev = (gx_device_printer *)pdev;
     gs_devn_params *pdevn_params;
     int outcode = 0, errcode = 0, endcode, closecode = 0;
-    int code;
-
-    prn_finish_bg_print(ppdev);		/* finish any previous background printing */
+    int code, bgcode;
+    int depth = ppdev->bg_print_depth;
+
+    /* finish any previous background printing, or as much as needed to start */
+    /* another page when several pages may print in the background.          */
+    /* Only pages written to files of their own can overlap: pages sharing a  */
+    /* file would have to wait for each other to write, so they would render */
+    /* one at a time anyway. Nor can pages reopening the same file, or       */
+    /* numbering files for their copies.                                     */
+    if (depth < 1 || ppdev->ReopenPerPage || !bg_print_ok || num_copies <= 0 ||
+        ppdev->saved_pages_list != NULL || num_copies > 1 || !prn_file_per_page(ppdev))
+        depth = 1;
+    if (depth > BG_PRINT_MAX_DEPTH)
+        depth = BG_PRINT_MAX_DEPTH;
+    outcode = bgcode = prn_bg_print_make_room(ppdev, depth, 0);
 
     if (num_copies > 0 && ppdev->saved_pages_list != NULL) {
         /* We are putting pages on a list */
@@ -965,6 +1163,7 @@ gdev_prn_output_page_aux(gx_device * pdev, int num_copies, int flush, bool seeka
         if (num_copies > 0) {
             int threads_enabled = 0;
             int print_foreground = 1;		/* default to foreground printing */
+            bg_print_t *bg_print = NULL;	/* the page being started in the background */
 
             if (bg_print_ok && PRINTER_IS_CLIST(ppdev) && ppdev->bg_print &&
                 (ppdev->bg_print_requested || ppdev->num_render_threads_requested > 0)) {
@@ -974,56 +1173,76 @@ gdev_prn_output_page_aux(gx_device * pdev, int num_copies, int flush, bool seeka
             /* If there was an error, abort on this page -- no good way to handle this */
             /* but it means that the error will be reported AFTER another page was     */
             /* interpreted and written to clist files. FIXME: ???                      */
-            if (ppdev->bg_print && (ppdev->bg_print->return_code < 0)) {
-                outcode = ppdev->bg_print->return_code;
+            if (bgcode < 0)
                 threads_enabled = 0;	/* and allow current page to try foreground */
-            }
             /* Use 'while' instead of 'if' to avoid nesting */
             while (ppdev->bg_print_requested && ppdev->bg_print && threads_enabled) {
                 gx_device *ndev;
                 gx_device_printer *npdev;
                 gx_device_clist_reader *crdev = (gx_device_clist_reader *)ppdev;
+                bg_print_t *newest;
+                bool file_per_page = prn_file_per_page(ppdev);
+                int num_threads = ppdev->num_render_threads_requested;
+                int i;
 
                 if ((code = clist_close_writer_and_init_reader((gx_device_clist *)ppdev)) < 0)
                     /* should not happen -- do foreground print */
                     break;
 
+                /* The pages printing at the same time share the rendering threads */
+                if (depth > 1 && num_threads > 0)
+                    num_threads = (num_threads + depth - 1) / depth;
+                /* Wait until this page fits in the memory allowed */
+                if ((code = prn_bg_print_make_room(ppdev, depth,
+                                prn_bg_print_page_size(ppdev, num_threads))) < 0) {
+                    outcode = code;
+                    break;
+                }
+                for (i = 0; i < BG_PRINT_MAX_DEPTH && ppdev->bg_print[i].device != NULL; i++)
+                    ;
+                bg_print = &ppdev->bg_print[i];	/* make_room left one free */
+                bg_print->return_code = 0;
+
                 /* We need to hang onto references to these files, so we can ensure the main file data
                  * gets freed with the correct allocator.
                  */
-                ppdev->bg_print->ocfname =
+                bg_print->ocfname =
                      (char *)gs_alloc_bytes(ppdev->memory->non_gc_memory,
                            strnlen(crdev->page_info.cfname, gp_file_name_sizeof - 1) + 1, "gdev_prn_output_page_aux(ocfname)");
-                ppdev->bg_print->obfname =
+                bg_print->obfname =
                      (char *)gs_alloc_bytes(ppdev->memory->non_gc_memory,
                            strnlen(crdev->page_info.bfname, gp_file_name_sizeof - 1) + 1,"gdev_prn_output_page_aux(ocfname)");
 
-                if (!ppdev->bg_print->ocfname || !ppdev->bg_print->obfname)
+                if (!bg_print->ocfname || !bg_print->obfname)
                     break;
 
-                strncpy(ppdev->bg_print->ocfname, crdev->page_info.cfname, strnlen(crdev->page_info.cfname, gp_file_name_sizeof - 1) + 1);
-                strncpy(ppdev->bg_print->obfname, crdev->page_info.bfname, strnlen(crdev->page_info.bfname, gp_file_name_sizeof - 1) + 1);
-                ppdev->bg_print->obfile = crdev->page_info.bfile;
-                ppdev->bg_print->ocfile = crdev->page_info.cfile;
-                ppdev->bg_print->oio_procs = crdev->page_info.io_procs;
+                bg_print->size = prn_bg_print_page_size(ppdev, num_threads);
+                strncpy(bg_print->ocfname, crdev->page_info.cfname, strnlen(crdev->page_info.cfname, gp_file_name_sizeof - 1) + 1);
+                strncpy(bg_print->obfname, crdev->page_info.bfname, strnlen(crdev->page_info.bfname, gp_file_name_sizeof - 1) + 1);
+                bg_print->obfile = crdev->page_info.bfile;
+                bg_print->ocfile = crdev->page_info.cfile;
+                bg_print->oio_procs = crdev->page_info.io_procs;
                 crdev->page_info.cfile = crdev->page_info.bfile = NULL;
 
-                if (ppdev->bg_print->sema == NULL)
+                if (bg_print->sema == NULL)
                 {
-                    ppdev->bg_print->sema = gx_semaphore_label(gx_semaphore_alloc(ppdev->memory->non_gc_memory), "BGPrint");
-                    if (ppdev->bg_print->sema == NULL)
+                    bg_print->sema = gx_semaphore_label(gx_semaphore_alloc(ppdev->memory->non_gc_memory), "BGPrint");
+                    if (bg_print->sema == NULL)
                         break;			/* couldn't create the semaphore */
                 }
+                newest = prn_newest_bg_print(ppdev);
 
                 ndev = setup_device_and_mem_for_thread(pdev->memory->thread_safe_memory, pdev, true, NULL);
                 if (ndev == NULL) {
                     break;
                 }
-                ppdev->bg_print->device = ndev;
-                ppdev->bg_print->num_copies = num_copies;
+                bg_print->device = ndev;
+                bg_print->num_copies = num_copies;
+                bg_print->order = newest != NULL ? newest->order + 1 : 0;
                 npdev = (gx_device_printer *)ndev;
                 npdev->bg_print_requested = 0;
-                npdev->num_render_threads_requested = ppdev->num_render_threads_requested;
+                npdev->num_render_threads_requested = num_threads;
+                npdev->adaptive_banding_requested = ppdev->adaptive_banding_requested;
                 /* The bgprint's device was created with normal procs, so multi-threaded */
                 /* rendering was turned off. Re-enable it now if it is needed.           */
                 if (npdev->num_render_threads_requested > 0) {
@@ -1033,14 +1252,17 @@ gdev_prn_output_page_aux(gx_device * pdev, int num_copies, int flush, bool seeka
 
                 /* Now start the thread to print the page */
                 if ((code = gp_thread_start(prn_print_page_in_background,
-                                            (void *)(ppdev->bg_print),
-                                            &(ppdev->bg_print->thread_id))) < 0) {
+                                            (void *)bg_print,
+                                            &(bg_print->thread_id))) < 0) {
                     /* Did not start cleanly - clean up is in print_foreground block below */
                     break;
                 }
-                gp_thread_label(ppdev->bg_print->thread_id, "BG print thread");
+                gp_thread_label(bg_print->thread_id, "BG print thread");
                 /* Page was succesfully started in bg_print mode */
                 print_foreground = 0;
+                /* With a file per page, the thread now owns this page's file */
+                if (file_per_page)
+                    ppdev->file = NULL;
                 /* Now we need to set up the next page so it will use new clist files */
                 if ((code = clist_open(pdev)) < 0) 	/* this should do it */
                     /* OOPS! can't proceed with the next page */
@@ -1048,24 +1270,30 @@ gdev_prn_output_page_aux(gx_device * pdev, int num_copies, int flush, bool seeka
                 break;				/* exit the while loop */
             }
             if (print_foreground) {
-                if (ppdev->bg_print) {
-                     gs_free_object(ppdev->memory->non_gc_memory, ppdev->bg_print->ocfname, "gdev_prn_output_page_aux(ocfname)");
-                     gs_free_object(ppdev->memory->non_gc_memory, ppdev->bg_print->obfname, "gdev_prn_output_page_aux(obfname)");
-                     ppdev->bg_print->ocfname = ppdev->bg_print->obfname = NULL;
+                if (bg_print) {
+                     gs_free_object(ppdev->memory->non_gc_memory, bg_print->ocfname, "gdev_prn_output_page_aux(ocfname)");
+                     gs_free_object(ppdev->memory->non_gc_memory, bg_print->obfname, "gdev_prn_output_page_aux(obfname)");
+                     bg_print->ocfname = bg_print->obfname = NULL;
 
                     /* either bg_print was not requested or was not able to start */
-                    if (ppdev->bg_print->sema != NULL && ppdev->bg_print->device != NULL) {
+                    if (bg_print->sema != NULL && bg_print->device != NULL) {
                         /* There was a problem. Teardown the device and its allocator, but */
                         /* leave the semaphore for possible later use.                     */
-                        teardown_device_and_mem_for_thread(ppdev->bg_print->device,
-                                                           ppdev->bg_print->thread_id, true);
-                        ppdev->bg_print->device = NULL;
+                        teardown_device_and_mem_for_thread(bg_print->device,
+                                                           bg_print->thread_id, true);
+                        bg_print->device = NULL;
                     }
                 }
+                /* Any pages still printing in the background must be output first */
+                code = prn_bg_print_make_room(ppdev, 1, 0);
+                if (outcode == 0)
+                    outcode = code;
                 /* Here's where we actually let the device's print_page_copies work */
                 /* Print the accumulated page description. */
-                outcode = (*ppdev->printer_procs.print_page_copies)(ppdev, ppdev->file,
+                code = (*ppdev->printer_procs.print_page_copies)(ppdev, ppdev->file,
                                                           num_copies);
+                if (outcode == 0)
+                    outcode = code;
                 gp_fflush(ppdev->file);
                 errcode = (gp_ferror(ppdev->file) ? gs_note_error(gs_error_ioerror) : 0);
                 /* NB: background printing does this differently in its thread */
@@ -1706,12 +1934,8 @@ int
 gdev_prn_close_printer(gx_device * pdev)
 {
     gx_device_printer * const ppdev = (gx_device_printer *)pdev;
-    gs_parsed_file_name_t parsed;
-    const char *fmt;
-    int code = gx_parse_output_file_name(&parsed, &fmt, ppdev->fname,
-                                         strlen(ppdev->fname), pdev->memory);
 
-    if ((code >= 0 && fmt) /* file per page */ ||
+    if (prn_file_per_page(ppdev) ||
         ppdev->ReopenPerPage	/* close and reopen for each page */
         ) {
         gx_device_close_output_file(pdev, ppdev->fname, ppdev->file);
@@ -113,6 +113,12 @@ typedef struct gx_printer_device_procs_s {
 
 #define prn_fname_sizeof gp_file_name_sizeof
 
+/* Up to BGPrintDepth pages can be printing in the background at once, */
+/* each with its own bg_print_t in an array of BG_PRINT_MAX_DEPTH.       */
+#ifndef BG_PRINT_MAX_DEPTH
+#  define BG_PRINT_MAX_DEPTH 16
+#endif
+
 typedef struct bg_print_s {
     gx_semaphore_t *sema;		/* used by foreground to wait */
     gx_device *device;			/* printer/clist device for bg printing */
@@ -124,6 +130,8 @@ typedef struct bg_print_s {
     char *obfname;	                /* block file name */
     clist_file_ptr obfile;	/* block file, normally 0 */
     const clist_io_procs_t *oio_procs;
+    int order;				/* sequence of the page, if 'device' != NULL */
+    size_t size;			/* memory held until the page is finished */
 } bg_print_t;
 
 #define gx_prn_device_common\
@@ -142,7 +150,10 @@ typedef struct bg_print_s {
         gp_file *file;  		/* output file */\
         bool bg_print_requested;	/* request background printing of page from clist */\
         bg_print_t *bg_print;           /* background printing data shared with thread */\
+        int bg_print_depth;		/* max pages printing in the background (BGPrintDepth) */\
+        size_t bg_print_max_memory;	/* memory limit for those pages, 0 if none */\
         int num_render_threads_requested;	/* for multiple band rendering threads */\
+        bool adaptive_banding_requested;	/* split costly bands when rendering with threads */\
         gx_saved_pages_list *saved_pages_list;	/* list when we are saving pages instead of printing */\
         gx_device_procs save_procs_while_delaying_erasepage	/* save device procs while delaying erasepage. */
 
@@ -221,7 +232,10 @@ prn_dev_proc_get_space_params(gx_default_get_space_params);
         0,	        /* *file */\
         0/*false*/,	/* bg_print_requested */\
         0,              /* *bg_print */\
+        1,              /* bg_print_depth */\
+        0,              /* bg_print_max_memory */\
         0, 		/* num_render_threads_requested */\
+        0/*false*/,	/* adaptive_banding_requested */\
         0,              /* saved_pages_list */\
         { 0 }           /* save_procs_while_delaying_erasepage */
 #define prn_device_body_rest_(print_page)\
@@ -344,6 +344,15 @@ int gp_fprintf(gp_file *f, const char *fmt, ...)
 #endif
     ;
 
+/* Map the first size bytes of an open file read-only into memory.
+ * Returns NULL if the file (or the platform) does not support mapping,
+ * in which case the caller should fall back to reading the data.
+ * The mapping stays valid after the file is closed, until gp_funmap. */
+const void *gp_fmap(gp_file *f, size_t size);
+
+/* Release a mapping returned by gp_fmap. */
+void gp_funmap(const void *addr, size_t size);
+
 /* ------ Reading from stdin, unbuffered if possible ------ */
 
 /* Read bytes from stdin, using unbuffered if possible.
@@ -439,6 +448,16 @@ int gp_unlink(gs_memory_t *mem, const char *fname);
 /* Rename utf-8 filename, subject to 'control' path permissions */
 int gp_rename(gs_memory_t *mem, const char *from, const char *to);
 
+/* Open, unlink and rename utf-8 filenames without checking them against
+ * the permitted paths. These are only for files that the library manages
+ * itself, in places chosen by the user rather than by the job (such as
+ * the ICC link and glyph cache directories), so that those files need not
+ * be opened up to the job under -dSAFER. Never pass them a name that a
+ * job can influence. */
+gp_file *gp_fopen_unchecked(const gs_memory_t *mem, const char *fname, const char *mode);
+int gp_unlink_unchecked(gs_memory_t *mem, const char *fname);
+int gp_rename_unchecked(gs_memory_t *mem, const char *from, const char *to);
+
 /* gp_stat is defined in stat_.h rather than here due to macro problems */
 
 typedef enum {
@@ -669,6 +688,12 @@ FILE *gp_open_scratch_file_impl(const gs_memory_t *mem,
 /* Test whether this platform supports the sharing of file descriptors */
 int gp_can_share_fdesc(void);
 
+/* Map/unmap the start of a FILE read-only (see gp_fmap). Platforms
+ * without file mapping return NULL. */
+const void *gp_fmap_impl(FILE *f, size_t size);
+
+void gp_funmap_impl(const void *addr, size_t size);
+
 int gp_stat_impl(const gs_memory_t *mem, const char *path, struct stat *buf);
 
 file_enum *gp_enumerate_files_init_impl(gs_memory_t *memory, const char *pat, uint patlen);
@@ -305,6 +305,15 @@ int gp_pwrite_impl(char *buf, size_t count, gs_offset_t offset, FILE *f)
     return -1;
 }
 
+const void *gp_fmap_impl(FILE *f, size_t size)
+{
+    return NULL;
+}
+
+void gp_funmap_impl(const void *addr, size_t size)
+{
+}
+
 /* -------------- Helpers for gp_file_name_combine_generic ------------- */
 
 uint gp_file_name_root(const char *fname, uint len)
@@ -32,6 +32,9 @@
 #include "dirent_.h"
 #include "unistd_.h"
 #include <stdlib.h>             /* for mkstemp/mktemp */
+#ifdef HAVE_MMAP
+#include <sys/mman.h>
+#endif
 
 #if !defined(HAVE_FSEEKO)
 #define ftello ftell
@@ -245,6 +248,24 @@ int gp_pwrite_impl(const char *buf, size_t count, gs_offset_t offset, FILE *f)
 #endif
 }
 
+const void *gp_fmap_impl(FILE *f, size_t size)
+{
+#if defined(GS_NO_FILESYSTEM) || !defined(HAVE_MMAP)
+    return NULL;
+#else
+    void *addr = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fileno(f), 0);
+
+    return addr == MAP_FAILED ? NULL : addr;
+#endif
+}
+
+void gp_funmap_impl(const void *addr, size_t size)
+{
+#if !defined(GS_NO_FILESYSTEM) && defined(HAVE_MMAP)
+    munmap((void *)addr, size);
+#endif
+}
+
 /* Set a file into binary or text mode. */
 int
 gp_setmode_binary_impl(FILE * pfile, bool mode) /* lgtm [cpp/useless-expression] */
@@ -153,6 +153,31 @@ int gp_pwrite_impl(const char *buf, size_t count, gs_offset_t offset, FILE *f)
     return ret;
 }
 
+/* Map the start of a FILE read-only into memory */
+const void *gp_fmap_impl(FILE *f, size_t size)
+{
+    HANDLE hnd = (HANDLE)_get_osfhandle(fileno(f));
+    HANDLE map;
+    void *addr;
+
+    if (hnd == INVALID_HANDLE_VALUE)
+        return NULL;
+
+    map = CreateFileMapping(hnd, NULL, PAGE_READONLY, 0, 0, NULL);
+    if (map == NULL)
+        return NULL;
+    addr = MapViewOfFile(map, FILE_MAP_READ, 0, 0, size);
+    /* The view keeps the mapping object alive until it is unmapped */
+    CloseHandle(map);
+
+    return addr;
+}
+
+void gp_funmap_impl(const void *addr, size_t size)
+{
+    UnmapViewOfFile(addr);
+}
+
 /* --------- 64 bit file access ----------- */
 /* MSVC versions before 8 doen't provide big files.
    MSVC 8 doesn't distinguish big and small files,
@@ -704,15 +704,33 @@ char *gp_fgets(char *buffer, size_t n, gp_file *f)
     return buffer;
 }
 
-gp_file *
-gp_fopen(const gs_memory_t *mem, const char *fname, const char *mode)
+const void *gp_fmap(gp_file *f, size_t size)
 {
-    gp_file *file = NULL;
-    gs_lib_ctx_t *ctx = mem->gs_lib_ctx;
-    gs_fs_list_t *fs = ctx->core->fs;
+    FILE *file;
 
-    if (gp_validate_path(mem, fname, mode) != 0)
+    if (f == NULL || size == 0)
         return NULL;
+    file = gp_get_file(f);
+    if (file == NULL)
+        return NULL;
+    gp_fflush(f);
+    return gp_fmap_impl(file, size);
+}
+
+void gp_funmap(const void *addr, size_t size)
+{
+    if (addr != NULL)
+        gp_funmap_impl(addr, size);
+}
+
+/* Open a file through the registered file systems, without checking the
+ * name against the permitted paths. */
+static gp_file *
+gp_fopen_fs(const gs_memory_t *mem, const char *fname, const char *mode)
+{
+    gp_file *file = NULL;
+    gs_lib_ctx_t *ctx = mem->gs_lib_ctx;
+    gs_fs_list_t *fs;
 
     for (fs = ctx->core->fs; fs != NULL; fs = fs->next)
     {
@@ -728,6 +746,21 @@ gp_fopen(const gs_memory_t *mem, const char *fname, const char *mode)
     return file;
 }
 
+gp_file *
+gp_fopen(const gs_memory_t *mem, const char *fname, const char *mode)
+{
+    if (gp_validate_path(mem, fname, mode) != 0)
+        return NULL;
+
+    return gp_fopen_fs(mem, fname, mode);
+}
+
+gp_file *
+gp_fopen_unchecked(const gs_memory_t *mem, const char *fname, const char *mode)
+{
+    return gp_fopen_fs(mem, fname, mode);
+}
+
 gp_file *
 gp_open_printer(const gs_memory_t *mem,
                       char         fname[gp_file_name_sizeof],
@@ -1244,3 +1277,15 @@ gp_rename(gs_memory_t *mem, const char *from, const char *to)
 
     return gp_rename_impl(mem, from, to);
 }
+
+int
+gp_unlink_unchecked(gs_memory_t *mem, const char *fname)
+{
+    return gp_unlink_impl(mem, fname);
+}
+
+int
+gp_rename_unchecked(gs_memory_t *mem, const char *from, const char *to)
+{
+    return gp_rename_impl(mem, from, to);
+}
@@ -477,6 +477,9 @@ typedef struct gsicc_link_cache_s {
     gx_monitor_t *lock;		/* handle for the monitor */
     bool cache_full;		/* flag that some thread needs a cache slot */
     gx_semaphore_t *full_wait;	/* semaphore for waiting when the cache is full */
+    int file_hits;		/* links loaded from ICCLinkCacheDir */
+    int file_misses;		/* links not found there (or unusable) */
+    int file_writes;		/* links written there */
 } gsicc_link_cache_t;
 
 /* A linked list structure to keep DeviceN ICC profiles
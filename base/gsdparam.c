@@ -134,6 +134,7 @@ int gx_default_get_param(gx_device *dev, char *Param, void *list)
     gsicc_blackptcomp_t blackptcomps[NUM_DEVICE_PROFILES];
     gsicc_blackpreserve_t blackpreserve[NUM_DEVICE_PROFILES];
     int color_accuracy = MAX_COLOR_ACCURACY;
+    float image_clut_delta_e = gsicc_currentimageclutdeltae(dev->memory);
     int depth = dev->color_info.depth;
     cmm_dev_profile_t *dev_profile;
     char null_str[1]={'\0'};
@@ -501,6 +502,9 @@ int gx_default_get_param(gx_device *dev, char *Param, void *list)
     if (strcmp(Param, "ColorAccuracy") == 0) {
         return param_write_int(plist, "ColorAccuracy", (const int *)(&(color_accuracy)));
     }
+    if (strcmp(Param, "ImageCLUTDeltaE") == 0) {
+        return param_write_float(plist, "ImageCLUTDeltaE", &image_clut_delta_e);
+    }
     if (strcmp(Param, "RenderIntent") == 0) {
         return param_write_int(plist,"RenderIntent", (const int *) (&(profile_intents[0])));
     }
@@ -611,6 +615,7 @@ gx_default_get_params(gx_device * dev, gs_param_list * plist)
     bool prebandthreshold = true, temp_bool;
     int k;
     int color_accuracy = MAX_COLOR_ACCURACY;
+    float image_clut_delta_e = gsicc_currentimageclutdeltae(dev->memory);
     gs_param_float_array msa, ibba, hwra, ma;
     gs_param_string_array scna;
     char null_str[1]={'\0'};
@@ -800,6 +805,7 @@ gx_default_get_params(gx_device * dev, gs_param_list * plist)
         (code = param_write_string(plist,"ICCOutputColors", &(icc_colorants))) < 0 ||
         (code = param_write_int(plist, "RenderIntent", (const int *)(&(profile_intents[0])))) < 0 ||
         (code = param_write_int(plist, "ColorAccuracy", (const int *)(&(color_accuracy)))) < 0 ||
+        (code = param_write_float(plist, "ImageCLUTDeltaE", &image_clut_delta_e)) < 0 ||
         (code = param_write_int(plist,"VectorIntent", (const int *) &(profile_intents[1]))) < 0 ||
         (code = param_write_int(plist,"ImageIntent", (const int *) &(profile_intents[2]))) < 0 ||
         (code = param_write_int(plist,"TextIntent", (const int *) &(profile_intents[3]))) < 0 ||
@@ -1681,6 +1687,7 @@ gx_default_put_params(gx_device * dev, gs_param_list * plist)
     int leadingedge = dev->LeadingEdge;
     int k;
     int color_accuracy;
+    float image_clut_delta_e;
     bool devicegraytok = true;
     bool graydetection = false;
     bool usefastcolor = false;
@@ -1698,6 +1705,7 @@ gx_default_put_params(gx_device * dev, gs_param_list * plist)
                                                gsTEXTPROFILE};
 
     color_accuracy = gsicc_currentcoloraccuracy(dev->memory);
+    image_clut_delta_e = gsicc_currentimageclutdeltae(dev->memory);
     if (dev->icc_struct != NULL) {
         for (k = 0; k < NUM_DEVICE_PROFILES; k++) {
             rend_intent[k] = dev->icc_struct->rendercond[k].rendering_intent;
@@ -2051,6 +2059,14 @@ nce:
         ecode = code;
         param_signal_error(plist, param_name, ecode);
     }
+    if ((code = param_read_float(plist, (param_name = "ImageCLUTDeltaE"),
+                                                        &image_clut_delta_e)) < 0) {
+        ecode = code;
+        param_signal_error(plist, param_name, ecode);
+    } else if (image_clut_delta_e < 0) {
+        ecode = gs_note_error(gs_error_rangecheck);
+        param_signal_error(plist, param_name, ecode);
+    }
     if ((code = param_read_bool(plist, (param_name = "DeviceGrayToK"),
                                                         &devicegraytok)) < 0) {
         ecode = code;
@@ -2520,6 +2536,7 @@ label:\
             return code;
     }
     gsicc_setcoloraccuracy(dev->memory, color_accuracy);
+    gsicc_setimageclutdeltae(dev->memory, image_clut_delta_e);
     code = gx_default_put_graytok(devicegraytok, dev);
     if (code < 0)
         return code;
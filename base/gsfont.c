@@ -29,12 +29,22 @@
 #include "gzpath.h"		/* for default implementation */
 
 /* Define the sizes of the various aspects of the font/character cache. */
+/*
+ * On big memory machines the character cache is bounded by its byte
+ * budget (bmax) alone: the number of characters it is sized for and the
+ * largest character it will accept follow from the budget, so raising
+ * the budget (MaxFontCache) also keeps large, high resolution glyphs as
+ * bitmaps, rather than filling their outlines again on every use (and
+ * in every band, when banding).
+ */
+#define cmax_for_bmax(bmax) ((bmax) / 200)	/* cmax - # of cached chars */
+#define blimit_for_bmax(bmax) ((bmax) / 32)	/* blimit/upper - max size of a single cached char */
 /*** Big memory machines ***/
 #define smax_LARGE 50		/* smax - # of scaled fonts */
-#define bmax_LARGE 1000000	/* bmax - space for cached chars */
+#define bmax_LARGE 8000000	/* bmax - space for cached chars */
 #define mmax_LARGE 200		/* mmax - # of cached font/matrix pairs */
-#define cmax_LARGE 5000		/* cmax - # of cached chars */
-#define blimit_LARGE 32000	/* blimit/upper - max size of a single cached char */
+#define cmax_LARGE cmax_for_bmax(bmax_LARGE)
+#define blimit_LARGE blimit_for_bmax(bmax_LARGE)
 /*** Small memory machines ***/
 #define smax_SMALL 20		/* smax - # of scaled fonts */
 #define bmax_SMALL 25000	/* bmax - space for cached chars */
@@ -712,6 +722,12 @@ gs_setcachesize(gs_gstate * pgs, gs_font_dir * pdir, uint size)
        new cache size */
     gs_free_object(stable_mem, pdir->fmcache.mdata, "gs_setcachesize(mdata)");
     gs_free_object(stable_mem, pdir->ccache.table, "gs_setcachesize(table)");
+    /* Unless they were set explicitly, the character count and the limit
+       on the size of a single character follow the budget. */
+    if (pdir->ccache.cmax == cmax_for_bmax(pdir->ccache.bmax))
+        pdir->ccache.cmax = cmax_for_bmax(size);
+    if (pdir->ccache.upper == blimit_for_bmax(pdir->ccache.bmax))
+        pdir->ccache.upper = blimit_for_bmax(size);
     pdir->ccache.bmax = size;
     return gx_char_cache_alloc(stable_mem, stable_mem->non_gc_memory, pdir,
                                pdir->ccache.bmax, pdir->fmcache.mmax,
@@ -29,11 +29,21 @@
 #include "spprint.h"
 #include "stream.h"
 
+/* Define this to time the compiled functions against the interpreter */
+#undef BENCH_PTCR_FUNCTIONS
+
+#ifdef BENCH_PTCR_FUNCTIONS
+#include "gp.h"
+#endif
+
+typedef struct PtCc_code_s PtCc_code_t;
+
 typedef struct gs_function_PtCr_s {
     gs_function_head_t head;
     gs_function_PtCr_params_t params;
     /* Define a bogus DataSource for get_function_info. */
     gs_data_source_t data_source;
+    PtCc_code_t *code;		/* compiled ops, or 0 to interpret */
 } gs_function_PtCr_t;
 
 /* GC descriptor */
@@ -102,6 +112,1095 @@ typedef enum {
 
 } gs_PtCr_typed_opcode_t;
 
+/* ---------------- Compiled evaluation ---------------- */
+
+/*
+ * Functions whose stack depth and value types don't depend on the input
+ * values, which is nearly all of them, are compiled when they are created
+ * into code for a simple register machine. Every value computed gets a
+ * register of its own, so the stack operators disappear at compile time;
+ * operations on constants are done at compile time, which also removes
+ * if and ifelse with a constant condition; and repeat, whose count is
+ * constant in practice, is unrolled. If and ifelse with a variable
+ * condition become jumps, with moves to registers shared by the two
+ * branches where these leave different values on the stack.
+ *
+ * Registers hold floats, with Booleans held as the integers the
+ * interpreter uses. A register may hold a value that the interpreter would
+ * have as an integer on some paths (e.g. after { pop 0 } { 0.5 mul }
+ * ifelse), as long as all the integers involved are exact as floats, in
+ * which case the float operations give the same values. Integer operations
+ * on values not known at compile time, and anything else the compiler
+ * can't handle, leave the function to the interpreter. The compiled code
+ * does the same float operations as the interpreter, in the same order,
+ * so its results and errors are the same.
+ */
+
+/* Define the compiled opcodes. */
+typedef enum {
+        /* Binary operators: d = a op b */
+    PtCc_add, PtCc_sub, PtCc_mul, PtCc_div, PtCc_atan, PtCc_exp,
+    PtCc_and, PtCc_or, PtCc_xor,
+    PtCc_eq, PtCc_ne, PtCc_ge, PtCc_gt, PtCc_le, PtCc_lt,
+        /* Unary operators: d = op a */
+    PtCc_abs, PtCc_neg, PtCc_ceiling, PtCc_floor, PtCc_round,
+    PtCc_truncate, PtCc_sin, PtCc_cos, PtCc_sqrt, PtCc_ln, PtCc_log,
+    PtCc_not, PtCc_mov,
+        /* Control: jz goes to d if a is 0, out stores a in output d */
+    PtCc_jz, PtCc_jmp, PtCc_out, PtCc_return
+} gs_PtCc_opcode_t;
+
+typedef struct PtCc_insn_s {
+    ushort op, d, a, b;
+} PtCc_insn_t;
+
+/*
+ * The compiled code is followed by the instructions and then the values
+ * of the constants. The registers hold the constants, then the inputs,
+ * then the values computed.
+ */
+struct PtCc_code_s {
+    int num_insns;
+    int num_consts;
+    int num_regs;
+};
+#define PtCc_insns(code) ((const PtCc_insn_t *)((code) + 1))
+#define PtCc_consts(code)\
+  ((const float *)(PtCc_insns(code) + (code)->num_insns))
+
+/* Define the limits on what we compile. */
+#define PtCc_MAX_INSNS 4096
+#define PtCc_MAX_CONSTS 256
+#define PtCc_MAX_REGS 1024	/* including the constants */
+#define PtCc_MAX_STEPS 65536	/* operators compiled, after unrolling */
+#define PtCc_CONST 0x8000	/* operand is a constant, while compiling */
+#define PtCc_MAX_INT 0x1000000	/* largest integer all smaller are exact floats */
+
+/* Evaluate a compiled function. */
+static int
+fn_PtCc_evaluate(const PtCc_code_t *code, const float *in, int m, float *out)
+{
+    const PtCc_insn_t *const insns = PtCc_insns(code);
+    const PtCc_insn_t *ip = insns;
+    const float *consts = PtCc_consts(code);
+    float reg[PtCc_MAX_REGS];
+    int i;
+
+    /* These are short: avoid the overhead of calling memcpy. */
+    for (i = 0; i < code->num_consts; ++i)
+        reg[i] = consts[i];
+    for (i = 0; i < m; ++i)
+        reg[code->num_consts + i] = in[i];
+    for (; ; ++ip) {
+        switch ((gs_PtCc_opcode_t)ip->op) {
+        case PtCc_add:
+            reg[ip->d] = reg[ip->a] + reg[ip->b];
+            continue;
+        case PtCc_sub:
+            reg[ip->d] = reg[ip->a] - reg[ip->b];
+            continue;
+        case PtCc_mul:
+            reg[ip->d] = reg[ip->a] * reg[ip->b];
+            continue;
+        case PtCc_div:
+            if (reg[ip->b] == 0)
+                return_error(gs_error_undefinedresult);
+            reg[ip->d] = reg[ip->a] / reg[ip->b];
+            continue;
+        case PtCc_atan: {
+            double result;
+            int ecode = gs_atan2_degrees(reg[ip->a], reg[ip->b], &result);
+
+            if (ecode < 0)
+                return ecode;
+            reg[ip->d] = result;
+            continue;
+        }
+        case PtCc_exp:
+            reg[ip->d] = pow(reg[ip->a], reg[ip->b]);
+            continue;
+        case PtCc_and:
+            reg[ip->d] = (float)((int)reg[ip->a] & (int)reg[ip->b]);
+            continue;
+        case PtCc_or:
+            reg[ip->d] = (float)((int)reg[ip->a] | (int)reg[ip->b]);
+            continue;
+        case PtCc_xor:
+            reg[ip->d] = (float)((int)reg[ip->a] ^ (int)reg[ip->b]);
+            continue;
+        case PtCc_eq:
+            reg[ip->d] = (float)(reg[ip->a] == reg[ip->b]);
+            continue;
+        case PtCc_ne:
+            reg[ip->d] = (float)(reg[ip->a] != reg[ip->b]);
+            continue;
+        case PtCc_ge:
+            reg[ip->d] = (float)(reg[ip->a] >= reg[ip->b]);
+            continue;
+        case PtCc_gt:
+            reg[ip->d] = (float)(reg[ip->a] > reg[ip->b]);
+            continue;
+        case PtCc_le:
+            reg[ip->d] = (float)(reg[ip->a] <= reg[ip->b]);
+            continue;
+        case PtCc_lt:
+            reg[ip->d] = (float)(reg[ip->a] < reg[ip->b]);
+            continue;
+        case PtCc_abs:
+            reg[ip->d] = fabs(reg[ip->a]);
+            continue;
+        case PtCc_neg:
+            reg[ip->d] = -reg[ip->a];
+            continue;
+        case PtCc_ceiling:
+            reg[ip->d] = ceil(reg[ip->a]);
+            continue;
+        case PtCc_floor:
+            reg[ip->d] = floor(reg[ip->a]);
+            continue;
+        case PtCc_round:
+            reg[ip->d] = floor(reg[ip->a] + 0.5);
+            continue;
+        case PtCc_truncate:
+            reg[ip->d] = (reg[ip->a] < 0 ? ceil(reg[ip->a]) :
+                          floor(reg[ip->a]));
+            continue;
+        case PtCc_sin:
+            reg[ip->d] = gs_sin_degrees(reg[ip->a]);
+            continue;
+        case PtCc_cos:
+            reg[ip->d] = gs_cos_degrees(reg[ip->a]);
+            continue;
+        case PtCc_sqrt:
+            reg[ip->d] = sqrt(reg[ip->a]);
+            continue;
+        case PtCc_ln:
+            reg[ip->d] = log(reg[ip->a]);
+            continue;
+        case PtCc_log:
+            reg[ip->d] = log10(reg[ip->a]);
+            continue;
+        case PtCc_not:
+            reg[ip->d] = (float)~(int)reg[ip->a];
+            continue;
+        case PtCc_mov:
+            reg[ip->d] = reg[ip->a];
+            continue;
+        case PtCc_jz:
+            if (reg[ip->a] == 0)
+                ip = insns + ip->d - 1;
+            continue;
+        case PtCc_jmp:
+            ip = insns + ip->d - 1;
+            continue;
+        case PtCc_out:
+            out[ip->d] = reg[ip->a];
+            continue;
+        case PtCc_return:
+            return 0;
+        }
+    }
+}
+
+/* Define the compile-time stack values. */
+typedef struct PtCc_value_s {
+    calc_value_type_t type;	/* CVT_BOOL or CVT_FLOAT if !is_const */
+    bool is_const;
+    ushort reg;			/* if !is_const */
+    int bound;			/* if !is_const, see PtCc_int_bound */
+    union {
+        int i;			/* also used for Boolean */
+        float f;
+    } value;			/* if is_const */
+} PtCc_value_t;
+
+typedef struct PtCc_state_s {
+    gs_memory_t *mem;		/* for temporary storage */
+    PtCc_insn_t *insns;
+    int num_insns, max_insns;
+    float consts[PtCc_MAX_CONSTS];
+    int num_consts;
+    int num_regs;		/* not including the constants */
+    int nesting;
+    int steps;
+    int depth;
+    PtCc_value_t stack[MAX_VSTACK];
+} PtCc_state_t;
+
+/* Save the stack around the branches of an if. */
+typedef struct PtCc_branch_s {
+    PtCc_value_t before[MAX_VSTACK];
+    PtCc_value_t after_then[MAX_VSTACK];
+    int join[MAX_VSTACK];	/* register, or -1 if the values are the same */
+    int bound[MAX_VSTACK];
+} PtCc_branch_t;
+
+static int
+PtCc_emit(PtCc_state_t *st, gs_PtCc_opcode_t op, int d, int a, int b)
+{
+    PtCc_insn_t *ip;
+
+    if (st->num_insns == st->max_insns) {
+        int max_insns = (st->max_insns == 0 ? 64 : st->max_insns * 2);
+        PtCc_insn_t *insns;
+
+        if (max_insns > PtCc_MAX_INSNS)
+            return -1;
+        insns = (PtCc_insn_t *)
+            gs_alloc_bytes(st->mem, max_insns * sizeof(PtCc_insn_t),
+                           "PtCc_emit");
+        if (insns == 0)
+            return -1;
+        if (st->num_insns > 0)
+            memcpy(insns, st->insns, st->num_insns * sizeof(PtCc_insn_t));
+        gs_free_object(st->mem, st->insns, "PtCc_emit");
+        st->insns = insns;
+        st->max_insns = max_insns;
+    }
+    ip = &st->insns[st->num_insns];
+    ip->op = op, ip->d = d, ip->a = a, ip->b = b;
+    return st->num_insns++;
+}
+
+/* Return the operand for a value, as a float. */
+static int
+PtCc_operand(PtCc_state_t *st, const PtCc_value_t *pv)
+{
+    float f;
+    int i;
+
+    if (!pv->is_const)
+        return pv->reg;
+    if (pv->type == CVT_FLOAT)
+        f = pv->value.f;
+    else
+        f = (float)(double)pv->value.i;
+    for (i = 0; i < st->num_consts; ++i)
+        if (!memcmp(&st->consts[i], &f, sizeof(f)))
+            return i | PtCc_CONST;
+    if (st->num_consts == PtCc_MAX_CONSTS)
+        return -1;
+    st->consts[st->num_consts] = f;
+    return st->num_consts++ | PtCc_CONST;
+}
+
+static int
+PtCc_new_reg(PtCc_state_t *st)
+{
+    if (st->num_regs >= PtCc_MAX_REGS - PtCc_MAX_CONSTS)
+        return -1;
+    return st->num_regs++;
+}
+
+/* Emit *pr = op *pa [*pb] into a new register. */
+static bool
+PtCc_emit_op(PtCc_state_t *st, gs_PtCc_opcode_t op, const PtCc_value_t *pa,
+             const PtCc_value_t *pb, calc_value_type_t type, PtCc_value_t *pr)
+{
+    int a = PtCc_operand(st, pa);
+    int b = (pb == 0 ? 0 : PtCc_operand(st, pb));
+    int d = PtCc_new_reg(st);
+
+    if (a < 0 || b < 0 || d < 0 || PtCc_emit(st, op, d, a, b) < 0)
+        return false;
+    pr->type = type;
+    pr->is_const = false;
+    pr->reg = d;
+    pr->bound = -1;
+    return true;
+}
+
+/*
+ * Do a float operation on constants. We run it through fn_PtCc_evaluate,
+ * so that the result is exactly what it would be at run time.
+ */
+static bool
+PtCc_fold(gs_PtCc_opcode_t op, const PtCc_value_t *pa, const PtCc_value_t *pb,
+          calc_value_type_t type, PtCc_value_t *pr)
+{
+    struct {
+        PtCc_code_t head;
+        PtCc_insn_t insns[3];
+    } code;
+    float in[2], result;
+
+    code.head.num_insns = 3;
+    code.head.num_consts = 0;
+    code.head.num_regs = 3;
+    code.insns[0].op = op, code.insns[0].d = 2;
+    code.insns[0].a = 0, code.insns[0].b = 1;
+    code.insns[1].op = PtCc_out, code.insns[1].d = 0;
+    code.insns[1].a = 2, code.insns[1].b = 0;
+    code.insns[2].op = PtCc_return;
+    in[0] = pa->value.f;
+    in[1] = (pb == 0 ? 0 : pb->value.f);
+    if (fn_PtCc_evaluate(&code.head, in, 2, &result) < 0)
+        return false;
+    pr->type = type;
+    pr->is_const = true;
+    if (type == CVT_BOOL)
+        pr->value.i = (int)result;
+    else
+        pr->value.f = result;
+    return true;
+}
+
+/* Convert an integer constant to a float, as PtCr_int_to_float does. */
+static void
+PtCc_int_to_float(PtCc_value_t *pv)
+{
+    if (pv->type == CVT_INT) {
+        pv->value.f = (float)(double)pv->value.i;
+        pv->type = CVT_FLOAT;
+    }
+}
+
+/*
+ * Return a bound on the absolute value of a number if the interpreter
+ * might have it as an integer, -1 if it is always a float, or max_int if
+ * it is an integer too large to be sure of being exact as a float.
+ */
+static int
+PtCc_int_bound(const PtCc_value_t *pv)
+{
+    if (!pv->is_const)
+        return pv->bound;
+    if (pv->type != CVT_INT)
+        return -1;
+    if (pv->value.i < -PtCc_MAX_INT || pv->value.i > PtCc_MAX_INT)
+        return max_int;
+    return (pv->value.i < 0 ? -pv->value.i : pv->value.i);
+}
+
+/* Do an integer operation on constants, as fn_PtCr_evaluate does. */
+static bool
+PtCc_fold_int(gs_PtCr_opcode_t op, int int1, int int2, PtCc_value_t *pr)
+{
+    pr->type = CVT_INT;
+    pr->is_const = true;
+    switch (op) {
+    case PtCr_add:
+        if ((int1 ^ int2) >= 0 && ((int)((uint)int1 + int2) ^ int1) < 0) {
+            pr->type = CVT_FLOAT;
+            pr->value.f = (double)int1 + int2;
+        } else
+            pr->value.i = (int)((uint)int1 + int2);
+        return true;
+    case PtCr_sub:
+        if ((int1 ^ int2) < 0 && ((int)((uint)int1 - int2) ^ int1) >= 0) {
+            pr->type = CVT_FLOAT;
+            pr->value.f = (double)int1 - int2;
+        } else
+            pr->value.i = (int)((uint)int1 - int2);
+        return true;
+    case PtCr_mul: {
+        double prod = (double)int1 * int2;
+
+        if (prod < min_int || prod > max_int) {
+            pr->type = CVT_FLOAT;
+            pr->value.f = prod;
+        } else
+            pr->value.i = (int)prod;
+        return true;
+    }
+    case PtCr_and:
+        pr->value.i = int1 & int2;
+        return true;
+    case PtCr_or:
+        pr->value.i = int1 | int2;
+        return true;
+    case PtCr_xor:
+        pr->value.i = int1 ^ int2;
+        return true;
+    case PtCr_bitshift:
+#define MAX_SHIFT (ARCH_SIZEOF_INT * 8 - 1)
+        if (int2 < -MAX_SHIFT || int2 > MAX_SHIFT)
+            pr->value.i = 0;
+#undef MAX_SHIFT
+        else if (int2 < 0)
+            pr->value.i = ((uint)int1) >> -int2;
+        else
+            pr->value.i = (int)((uint)int1 << int2);
+        return true;
+    case PtCr_idiv:
+        if (int2 == 0 || (int1 == min_int && int2 == -1))
+            return false;
+        pr->value.i = int1 / int2;
+        return true;
+    case PtCr_mod:
+        if (int2 == 0)
+            return false;
+        pr->value.i = int1 % int2;
+        return true;
+    case PtCr_eq:
+        pr->value.i = int1 == int2;
+        break;
+    case PtCr_ne:
+        pr->value.i = int1 != int2;
+        break;
+    case PtCr_ge:
+        pr->value.i = int1 >= int2;
+        break;
+    case PtCr_gt:
+        pr->value.i = int1 > int2;
+        break;
+    case PtCr_le:
+        pr->value.i = int1 <= int2;
+        break;
+    case PtCr_lt:
+        pr->value.i = int1 < int2;
+        break;
+    default:
+        return false;
+    }
+    pr->type = CVT_BOOL;
+    return true;
+}
+
+/* Compile a binary operator. */
+static bool
+PtCc_binary(PtCc_state_t *st, gs_PtCr_opcode_t op)
+{
+    PtCc_value_t *pa, *pb, r;
+    gs_PtCc_opcode_t fop;
+    calc_value_type_t type = CVT_BOOL;
+    int bound = -1;
+
+    if (st->depth < 2)
+        return false;
+    pa = &st->stack[st->depth - 2];
+    pb = &st->stack[st->depth - 1];
+    switch (op) {
+    case PtCr_and: fop = PtCc_and; goto logical;
+    case PtCr_or: fop = PtCc_or; goto logical;
+    case PtCr_xor: fop = PtCc_xor;
+    logical:
+        if (pa->type == CVT_FLOAT || pb->type == CVT_FLOAT)
+            return false;
+        if (pa->is_const && pb->is_const) {
+            PtCc_fold_int(op, pa->value.i, pb->value.i, &r);
+            r.type = pa->type;
+            break;
+        }
+        if (pa->type != CVT_BOOL || pb->type != CVT_BOOL ||
+            !PtCc_emit_op(st, fop, pa, pb, CVT_BOOL, &r))
+            return false;
+        break;
+    case PtCr_bitshift: case PtCr_idiv: case PtCr_mod:
+        if (pa->type != CVT_INT || pb->type != CVT_INT ||
+            !pa->is_const || !pb->is_const ||
+            !PtCc_fold_int(op, pa->value.i, pb->value.i, &r))
+            return false;
+        break;
+    case PtCr_eq: fop = PtCc_eq; goto eq;
+    case PtCr_ne: fop = PtCc_ne;
+    eq:
+        if (pa->type == CVT_BOOL || pb->type == CVT_BOOL) {
+            if (pa->type != pb->type)
+                return false;
+            if (pa->is_const && pb->is_const) {
+                r.type = CVT_BOOL;
+                r.is_const = true;
+                r.value.i = (pa->value.i == pb->value.i) == (op == PtCr_eq);
+            } else if (!PtCc_emit_op(st, fop, pa, pb, CVT_BOOL, &r))
+                return false;
+            break;
+        }
+        goto num;
+    case PtCr_ge: fop = PtCc_ge; goto num;
+    case PtCr_gt: fop = PtCc_gt; goto num;
+    case PtCr_le: fop = PtCc_le; goto num;
+    case PtCr_lt: fop = PtCc_lt; goto num;
+    case PtCr_add: fop = PtCc_add; goto arith;
+    case PtCr_sub: fop = PtCc_sub; goto arith;
+    case PtCr_mul: fop = PtCc_mul;
+    arith:
+        type = CVT_FLOAT;
+    num:
+        if (pa->type == CVT_BOOL || pb->type == CVT_BOOL)
+            return false;
+        if (pa->type == CVT_INT && pb->type == CVT_INT &&
+            pa->is_const && pb->is_const) {
+            PtCc_fold_int(op, pa->value.i, pb->value.i, &r);
+            break;
+        }
+        {
+            /*
+             * If both might be integers, the interpreter might do integer
+             * arithmetic, which the float operation matches as long as
+             * the operands and the result are exact.
+             */
+            int ba = PtCc_int_bound(pa), bb = PtCc_int_bound(pb);
+
+            if (ba >= 0 && bb >= 0) {
+                double rb = (op == PtCr_mul ? (double)ba * bb :
+                             (double)ba + bb);
+
+                if (ba > PtCc_MAX_INT || bb > PtCc_MAX_INT ||
+                    (type == CVT_FLOAT && rb > PtCc_MAX_INT))
+                    return false;
+                /* 0 times a negative integer is 0, not -0.0. */
+                if (op == PtCr_mul &&
+                    !(pa->is_const && pa->value.i > 0) &&
+                    !(pb->is_const && pb->value.i > 0))
+                    return false;
+                if (type == CVT_FLOAT)
+                    bound = (int)rb;
+            }
+        }
+        goto math;
+    case PtCr_atan: fop = PtCc_atan; goto math2;
+    case PtCr_div: fop = PtCc_div; goto math2;
+    case PtCr_exp: fop = PtCc_exp;
+    math2:
+        if (pa->type == CVT_BOOL || pb->type == CVT_BOOL)
+            return false;
+        type = CVT_FLOAT;
+    math:
+        PtCc_int_to_float(pa);
+        PtCc_int_to_float(pb);
+        if (pa->is_const && pb->is_const) {
+            if (!PtCc_fold(fop, pa, pb, type, &r))
+                return false;
+        } else if (!PtCc_emit_op(st, fop, pa, pb, type, &r))
+            return false;
+        else
+            r.bound = bound;
+        break;
+    default:
+        return false;
+    }
+    st->stack[--st->depth - 1] = r;
+    return true;
+}
+
+/* Compile a unary operator. */
+static bool
+PtCc_unary(PtCc_state_t *st, gs_PtCr_opcode_t op)
+{
+    PtCc_value_t *pv;
+    gs_PtCc_opcode_t fop;
+    int bound;
+
+    if (st->depth < 1)
+        return false;
+    pv = &st->stack[st->depth - 1];
+    switch (pv->type) {
+    case CVT_BOOL:
+        if (op != PtCr_not)
+            return false;
+        if (pv->is_const) {
+            pv->value.i = ~pv->value.i;
+            return true;
+        }
+        return PtCc_emit_op(st, PtCc_not, pv, 0, CVT_BOOL, pv);
+    case CVT_INT:		/* always a constant */
+        switch (op) {
+        case PtCr_ceiling: case PtCr_cvi: case PtCr_floor:
+        case PtCr_round: case PtCr_truncate:
+            return true;
+        case PtCr_abs: case PtCr_neg: case PtCr_not:
+            if (op == PtCr_not)
+                pv->value.i = ~pv->value.i;
+            else if (op == PtCr_abs && pv->value.i >= 0)
+                DO_NOTHING;
+            else if (pv->value.i == min_int)
+                PtCc_int_to_float(pv);	/* =self negated */
+            else
+                pv->value.i = -pv->value.i;
+            return true;
+        default:
+            PtCc_int_to_float(pv);
+        }
+        break;
+    default:
+        break;
+    }
+    /* These keep any integer the value might be, and so its bound. */
+    bound = (pv->is_const ? -1 : pv->bound);
+    switch (op) {
+    case PtCr_abs: fop = PtCc_abs; break;
+    case PtCr_ceiling: fop = PtCc_ceiling; break;
+    case PtCr_floor: fop = PtCc_floor; break;
+    case PtCr_neg:
+        /* The negation of an integer 0 is 0, not -0.0. */
+        if (bound >= 0)
+            return false;
+        fop = PtCc_neg;
+        break;
+    case PtCr_round: fop = PtCc_round; break;
+    case PtCr_truncate: fop = PtCc_truncate; break;
+    case PtCr_cos: fop = PtCc_cos; bound = -1; break;
+    case PtCr_ln: fop = PtCc_ln; bound = -1; break;
+    case PtCr_log: fop = PtCc_log; bound = -1; break;
+    case PtCr_sin: fop = PtCc_sin; bound = -1; break;
+    case PtCr_sqrt: fop = PtCc_sqrt; bound = -1; break;
+    case PtCr_cvr:
+        if (!pv->is_const)
+            pv->bound = -1;
+        return true;
+    case PtCr_cvi:
+        /* Only constants, and only where the conversion is defined. */
+        if (!pv->is_const ||
+            !(pv->value.f >= min_int && pv->value.f < -(float)min_int))
+            return false;
+        {
+            int int1 = (int)(pv->value.f);
+
+            pv->value.i = int1;
+            pv->type = CVT_INT;
+        }
+        return true;
+    default:
+        return false;
+    }
+    if (pv->is_const)
+        return PtCc_fold(fop, pv, 0, CVT_FLOAT, pv);
+    if (!PtCc_emit_op(st, fop, pv, 0, CVT_FLOAT, pv))
+        return false;
+    pv->bound = bound;
+    return true;
+}
+
+/* Pop an integer constant operand of a stack operator or repeat. */
+static bool
+PtCc_pop_int(PtCc_state_t *st, int *pi)
+{
+    const PtCc_value_t *pv;
+
+    if (st->depth < 1)
+        return false;
+    pv = &st->stack[st->depth - 1];
+    if (pv->type != CVT_INT || !pv->is_const)
+        return false;
+    *pi = pv->value.i;
+    --st->depth;
+    return true;
+}
+
+static void
+PtCc_reverse(PtCc_value_t *pv, int n)
+{
+    int i;
+
+    for (i = 0; i < n - 1 - i; ++i) {
+        PtCc_value_t v = pv[i];
+
+        pv[i] = pv[n - 1 - i];
+        pv[n - 1 - i] = v;
+    }
+}
+
+/*
+ * Return the end of the operator at p, including the bodies of if, ifelse
+ * and repeat, or 0 if it is too deeply nested.
+ */
+static const byte *
+PtCc_skip(const byte *p, int nesting)
+{
+    switch (*p++) {
+    case PtCr_byte:
+        return p + 1;
+    case PtCr_int:
+        return p + sizeof(int);
+    case PtCr_float:
+        return p + sizeof(float);
+    case PtCr_if: {
+        const byte *q = p + 2;
+        const byte *end = q + (p[0] << 8) + p[1];
+
+        if (nesting >= MAX_PSC_FUNCTION_NESTING)
+            return 0;
+        while (q < end) {
+            if (*q == PtCr_else)
+                return end + (q[1] << 8) + q[2];
+            if ((q = PtCc_skip(q, nesting + 1)) == 0)
+                return 0;
+        }
+        return end;
+    }
+    case PtCr_else:
+        return p + 2;
+    case PtCr_repeat:
+        return p + 2 + (p[0] << 8) + p[1] + 1;
+    default:
+        return p;
+    }
+}
+
+static bool PtCc_compile_ops(PtCc_state_t *st, const byte *p,
+                             const byte *end);
+
+static bool
+PtCc_same_value(const PtCc_value_t *pa, const PtCc_value_t *pb)
+{
+    if (pa->type != pb->type || pa->is_const != pb->is_const)
+        return false;
+    if (!pa->is_const)
+        return pa->reg == pb->reg;
+    if (pa->type == CVT_FLOAT)
+        return !memcmp(&pa->value.f, &pb->value.f, sizeof(float));
+    return pa->value.i == pb->value.i;
+}
+
+/*
+ * Compile if or ifelse with a condition that isn't known until run time.
+ * The values that the two branches leave in a stack slot get a register of
+ * their own if they differ, set at the end of each branch:
+ *
+ *      jz cond, L1; <then>; jmp L2;
+ *  L1: <else>; <else moves>; jmp L3;
+ *  L2: <then moves>;
+ *  L3:
+ */
+static bool
+PtCc_compile_if(PtCc_state_t *st, int cond,
+                const byte *then_p, const byte *then_end,
+                const byte *else_p, const byte *else_end)
+{
+    PtCc_branch_t *br = (PtCc_branch_t *)
+        gs_alloc_bytes(st->mem, sizeof(*br), "PtCc_compile_if");
+    int depth = st->depth, then_depth;
+    int jz, jmp_then, jmp_else, i;
+    bool ok = false;
+
+    if (br == 0)
+        return false;
+    memcpy(br->before, st->stack, depth * sizeof(PtCc_value_t));
+    if ((jz = PtCc_emit(st, PtCc_jz, 0, cond, 0)) < 0 ||
+        !PtCc_compile_ops(st, then_p, then_end) ||
+        (jmp_then = PtCc_emit(st, PtCc_jmp, 0, 0, 0)) < 0)
+        goto out;
+    memcpy(br->after_then, st->stack, st->depth * sizeof(PtCc_value_t));
+    then_depth = st->depth;
+    memcpy(st->stack, br->before, depth * sizeof(PtCc_value_t));
+    st->depth = depth;
+    st->insns[jz].d = st->num_insns;
+    if (else_p != 0 && !PtCc_compile_ops(st, else_p, else_end))
+        goto out;
+    if (st->depth != then_depth)
+        goto out;
+    for (i = 0; i < st->depth; ++i) {
+        const PtCc_value_t *pa = &br->after_then[i];
+        const PtCc_value_t *pb = &st->stack[i];
+        int b;
+
+        br->join[i] = -1;
+        if (PtCc_same_value(pa, pb))
+            continue;
+        if ((pa->type == CVT_BOOL) != (pb->type == CVT_BOOL))
+            goto out;
+        if (pb->type != CVT_BOOL) {
+            int ba = PtCc_int_bound(pa), bb = PtCc_int_bound(pb);
+
+            if (ba > PtCc_MAX_INT || bb > PtCc_MAX_INT)
+                goto out;
+            br->bound[i] = max(ba, bb);
+        }
+        if ((br->join[i] = PtCc_new_reg(st)) < 0 ||
+            (b = PtCc_operand(st, pb)) < 0 ||
+            PtCc_emit(st, PtCc_mov, br->join[i], b, 0) < 0)
+            goto out;
+    }
+    if ((jmp_else = PtCc_emit(st, PtCc_jmp, 0, 0, 0)) < 0)
+        goto out;
+    st->insns[jmp_then].d = st->num_insns;
+    for (i = 0; i < st->depth; ++i)
+        if (br->join[i] >= 0) {
+            int a = PtCc_operand(st, &br->after_then[i]);
+
+            if (a < 0 || PtCc_emit(st, PtCc_mov, br->join[i], a, 0) < 0)
+                goto out;
+            if (st->stack[i].type != CVT_BOOL) {
+                st->stack[i].type = CVT_FLOAT;
+                st->stack[i].bound = br->bound[i];
+            }
+            st->stack[i].is_const = false;
+            st->stack[i].reg = br->join[i];
+        }
+    st->insns[jmp_else].d = st->num_insns;
+    ok = true;
+ out:
+    gs_free_object(st->mem, br, "PtCc_compile_if");
+    return ok;
+}
+
+/* Compile the operators from p to end. */
+static bool
+PtCc_compile_ops(PtCc_state_t *st, const byte *p, const byte *end)
+{
+    bool ok = true;
+
+    if (++st->nesting > MAX_PSC_FUNCTION_NESTING)
+        return false;
+    while (ok && p < end) {
+        PtCc_value_t v;
+        int i, n;
+
+        if (++st->steps > PtCc_MAX_STEPS) {
+            ok = false;
+            break;
+        }
+        v.is_const = true;
+        switch ((gs_PtCr_opcode_t)*p++) {
+
+            /* Constants */
+
+        case PtCr_byte:
+            v.type = CVT_INT, v.value.i = *p++;
+            goto push;
+        case PtCr_int:
+            v.type = CVT_INT;
+            memcpy(&v.value.i, p, sizeof(int));
+            p += sizeof(int);
+            goto push;
+        case PtCr_float:
+            v.type = CVT_FLOAT;
+            memcpy(&v.value.f, p, sizeof(float));
+            p += sizeof(float);
+            goto push;
+        case PtCr_true:
+            v.type = CVT_BOOL, v.value.i = true;
+            goto push;
+        case PtCr_false:
+            v.type = CVT_BOOL, v.value.i = false;
+        push:
+            if (st->depth == MAX_VSTACK) {
+                ok = false;
+                break;
+            }
+            st->stack[st->depth++] = v;
+            continue;
+
+            /* Stack operators */
+
+        case PtCr_dup:
+            if (st->depth < 1) {
+                ok = false;
+                break;
+            }
+            v = st->stack[st->depth - 1];
+            goto push;
+        case PtCr_exch:
+            if (st->depth < 2) {
+                ok = false;
+                break;
+            }
+            v = st->stack[st->depth - 1];
+            st->stack[st->depth - 1] = st->stack[st->depth - 2];
+            st->stack[st->depth - 2] = v;
+            continue;
+        case PtCr_pop:
+            if (st->depth < 1) {
+                ok = false;
+                break;
+            }
+            --st->depth;
+            continue;
+        case PtCr_index:
+            if (!PtCc_pop_int(st, &i) || i < 0 || i >= st->depth) {
+                ok = false;
+                break;
+            }
+            v = st->stack[st->depth - 1 - i];
+            goto push;
+        case PtCr_copy:
+            if (!PtCc_pop_int(st, &i) || i < 0 || i > st->depth ||
+                i > MAX_VSTACK - st->depth) {
+                ok = false;
+                break;
+            }
+            memcpy(&st->stack[st->depth], &st->stack[st->depth - i],
+                   i * sizeof(PtCc_value_t));
+            st->depth += i;
+            continue;
+        case PtCr_roll:
+            if (!PtCc_pop_int(st, &i) || !PtCc_pop_int(st, &n) ||
+                n < 0 || n > st->depth) {
+                ok = false;
+                break;
+            }
+            if (n > 1) {
+                PtCc_value_t *pv = &st->stack[st->depth - n];
+
+                i %= n;
+                if (i < 0)
+                    i += n;
+                PtCc_reverse(pv, n);
+                PtCc_reverse(pv, i);
+                PtCc_reverse(pv + i, n - i);
+            }
+            continue;
+
+            /* Special */
+
+        case PtCr_if: {
+            const byte *then_end = p + 2 + (p[0] << 8) + p[1];
+            const byte *q = p + 2;
+            const byte *else_end = 0;
+
+            if (st->depth < 1 || st->stack[st->depth - 1].type != CVT_BOOL ||
+                then_end > end) {
+                ok = false;
+                break;
+            }
+            v = st->stack[--st->depth];
+            /* Look for the else at the end of the first body. */
+            while (q != 0 && q < then_end && *q != PtCr_else)
+                q = PtCc_skip(q, st->nesting);
+            if (q == 0 || q > then_end) {
+                ok = false;
+                break;
+            }
+            if (q < then_end) {
+                else_end = then_end + (q[1] << 8) + q[2];
+                if (q + 3 != then_end || else_end > end) {
+                    ok = false;
+                    break;
+                }
+            }
+            if (!v.is_const)
+                ok = PtCc_compile_if(st, v.reg, p + 2, q,
+                                     (else_end ? then_end : 0), else_end);
+            else if (v.value.i)
+                ok = PtCc_compile_ops(st, p + 2, q);
+            else if (else_end)
+                ok = PtCc_compile_ops(st, then_end, else_end);
+            p = (else_end ? else_end : then_end);
+            continue;
+        }
+        case PtCr_return:
+            /* Anywhere but at the top level, the depth might vary. */
+            ok = st->nesting == 1;
+            p = end;
+            continue;
+        case PtCr_repeat: {
+            const byte *body = p + 2;
+            const byte *body_end = body + (p[0] << 8) + p[1];
+
+            if (!PtCc_pop_int(st, &n) || body_end >= end ||
+                *body_end != PtCr_repeat_end) {
+                ok = false;
+                break;
+            }
+            for (i = 0; ok && i < n; ++i)
+                ok = ++st->steps <= PtCc_MAX_STEPS &&
+                    PtCc_compile_ops(st, body, body_end);
+            p = body_end + 1;
+            continue;
+        }
+
+            /* Arithmetic and comparison operators */
+
+        case PtCr_abs: case PtCr_ceiling: case PtCr_cos: case PtCr_cvi:
+        case PtCr_cvr: case PtCr_floor: case PtCr_ln: case PtCr_log:
+        case PtCr_neg: case PtCr_not: case PtCr_round: case PtCr_sin:
+        case PtCr_sqrt: case PtCr_truncate:
+            ok = PtCc_unary(st, p[-1]);
+            continue;
+        case PtCr_add: case PtCr_and: case PtCr_atan: case PtCr_bitshift:
+        case PtCr_div: case PtCr_exp: case PtCr_idiv: case PtCr_mod:
+        case PtCr_mul: case PtCr_or: case PtCr_sub: case PtCr_xor:
+        case PtCr_eq: case PtCr_ge: case PtCr_gt: case PtCr_le:
+        case PtCr_lt: case PtCr_ne:
+            ok = PtCc_binary(st, p[-1]);
+            continue;
+
+        default:		/* else and repeat_end are handled above */
+            ok = false;
+            break;
+        }
+    }
+    --st->nesting;
+    return ok;
+}
+
+/*
+ * Compile a function. If we can't, leave pfn->code 0, so that the function
+ * is interpreted.
+ */
+static void
+fn_PtCr_compile(gs_function_PtCr_t *pfn, gs_memory_t *mem)
+{
+    gs_memory_t *tmem = mem->non_gc_memory;
+    PtCc_state_t *st = (PtCc_state_t *)
+        gs_alloc_bytes(tmem, sizeof(*st), "fn_PtCr_compile");
+    int m = pfn->params.m, n = pfn->params.n;
+    int extra, i;
+    bool ok;
+
+    pfn->code = 0;
+    if (st == 0)
+        return;
+    st->mem = tmem;
+    st->insns = 0;
+    st->num_insns = st->max_insns = 0;
+    st->num_consts = 0;
+    st->nesting = st->steps = 0;
+    for (i = 0; i < m; ++i) {
+        st->stack[i].type = CVT_FLOAT;
+        st->stack[i].is_const = false;
+        st->stack[i].reg = i;
+        st->stack[i].bound = -1;
+    }
+    st->depth = st->num_regs = m;
+    ok = PtCc_compile_ops(st, pfn->params.ops.data,
+                          pfn->params.ops.data + pfn->params.ops.size);
+    /* Take the outputs from the top of the stack, as at fin: above. */
+    extra = st->depth - n;
+    ok = ok && extra >= 0;
+    for (i = 0; ok && i < n; ++i) {
+        const PtCc_value_t *pv = &st->stack[extra + i];
+        int a = PtCc_operand(st, pv);
+
+        ok = pv->type != CVT_BOOL && a >= 0 &&
+            PtCc_emit(st, PtCc_out, i, a, 0) >= 0;
+    }
+    if (ok && PtCc_emit(st, PtCc_return, 0, 0, 0) >= 0) {
+        PtCc_code_t *code = (PtCc_code_t *)
+            gs_alloc_bytes(mem, sizeof(PtCc_code_t) +
+                           st->num_insns * sizeof(PtCc_insn_t) +
+                           st->num_consts * sizeof(float),
+                           "fn_PtCr_compile");
+
+        if (code != 0) {
+            PtCc_insn_t *insns = (PtCc_insn_t *)(code + 1);
+
+            code->num_insns = st->num_insns;
+            code->num_consts = st->num_consts;
+            code->num_regs = st->num_consts + st->num_regs;
+            /* Number the registers after the constants. */
+#define REG(r) ((r) & PtCc_CONST ? (r) & ~PtCc_CONST : (r) + st->num_consts)
+            for (i = 0; i < st->num_insns; ++i) {
+                PtCc_insn_t *ip = &st->insns[i];
+
+                switch ((gs_PtCc_opcode_t)ip->op) {
+                case PtCc_jmp:
+                case PtCc_return:
+                    break;
+                case PtCc_jz:
+                case PtCc_out:
+                    ip->a = REG(ip->a);
+                    break;
+                default:
+                    ip->d = REG(ip->d);
+                    ip->a = REG(ip->a);
+                    ip->b = REG(ip->b);
+                }
+            }
+#undef REG
+            memcpy(insns, st->insns, st->num_insns * sizeof(PtCc_insn_t));
+            memcpy(insns + st->num_insns, st->consts,
+                   st->num_consts * sizeof(float));
+            pfn->code = code;
+        }
+    }
+    gs_free_object(tmem, st->insns, "fn_PtCr_compile");
+    gs_free_object(tmem, st, "fn_PtCr_compile");
+}
+
+/* ---------------- Interpretation ---------------- */
+
 /* Evaluate a PostScript Calculator function. */
 static int
 fn_PtCr_evaluate(const gs_function_t *pfn_common, const float *in, float *out)
@@ -221,6 +1320,9 @@ fn_PtCr_evaluate(const gs_function_t *pfn_common, const float *in, float *out)
         OP_NONE(PtCr_repeat_end)	/* repeat_end */
     };
 
+    if (pfn->code != 0)
+        return fn_PtCc_evaluate(pfn->code, in, pfn->params.m, out);
+
     memset(repeat_count, 0x00, MAX_PSC_FUNCTION_NESTING * sizeof(int));
     memset(repeat_proc_size, 0x00, MAX_PSC_FUNCTION_NESTING * sizeof(int));
 
@@ -756,6 +1858,7 @@ fn_PtCr_make_scaled(const gs_function_PtCr_t *pfn, gs_function_PtCr_t **ppsfn,
         gs_free_object(mem, psfn, "fn_PtCr_make_scaled");
         return_error(gs_error_VMerror);
     }
+    psfn->code = 0;
     psfn->params = pfn->params;
     psfn->params.ops.data = ops;
     psfn->params.ops.size = opsize;
@@ -794,6 +1897,7 @@ fn_PtCr_make_scaled(const gs_function_PtCr_t *pfn, gs_function_PtCr_t **ppsfn,
     psfn->params.ops.data =
         gs_resize_string(mem, ops, opsize, psfn->params.ops.size,
                          "fn_PtCr_make_scaled");
+    fn_PtCr_compile(psfn, mem);
     *ppsfn = psfn;
     return 0;
 }
@@ -808,6 +1912,17 @@ gs_function_PtCr_free_params(gs_function_PtCr_params_t * params, gs_memory_t * m
     fn_common_free_params((gs_function_params_t *) params, mem);
 }
 
+/* Free a PostScript Calculator function. */
+static void
+fn_PtCr_free(gs_function_t * pfn_common, bool free_params, gs_memory_t * mem)
+{
+    gs_function_PtCr_t *pfn = (gs_function_PtCr_t *)pfn_common;
+
+    gs_free_object(mem, pfn->code, "fn_PtCr_free");
+    pfn->code = 0;
+    fn_common_free(pfn_common, free_params, mem);
+}
+
 /* Serialize. */
 static int
 gs_function_PtCr_serialize(const gs_function_t * pfn, stream *s)
@@ -824,6 +1939,63 @@ gs_function_PtCr_serialize(const gs_function_t * pfn, stream *s)
     return sputs(s, p->ops.data, p->ops.size, &n);
 }
 
+#ifdef BENCH_PTCR_FUNCTIONS
+/* Time the compiled code against the interpreter on pseudo-random inputs
+ * in the Domain, and check that both give the same results. This runs for
+ * every function that compiles, in builds with BENCH_PTCR_FUNCTIONS. */
+static void
+bench_PtCr_function(gs_function_PtCr_t *pfn, gs_memory_t *mem)
+{
+    const int samples = 256, reps = 400;
+    int m = pfn->params.m, n = pfn->params.n;
+    float *in = (float *)gs_alloc_bytes(mem, samples * m * sizeof(float),
+                                        "bench_PtCr_function");
+    float *out = (float *)gs_alloc_bytes(mem, 2 * samples * n * sizeof(float),
+                                         "bench_PtCr_function");
+    int *codes = (int *)gs_alloc_bytes(mem, 2 * samples * sizeof(int),
+                                       "bench_PtCr_function");
+    PtCc_code_t *code = pfn->code;
+    long t[2], t0[2], t1[2];
+    uint seed = 1;
+    int i, j, k;
+
+    if (in == 0 || out == 0 || codes == 0)
+        goto done;
+    for (i = 0; i < samples * m; ++i) {
+        const float *domain = pfn->params.Domain + 2 * (i % m);
+
+        seed = seed * 1103515245 + 12345;
+        in[i] = domain[0] + (domain[1] - domain[0]) *
+            ((seed >> 16) & 0x7fff) / 32767.0;
+    }
+    memset(out, 0, 2 * samples * n * sizeof(float));
+    for (k = 0; k < 2; ++k) {
+        pfn->code = (k == 0 ? 0 : code);
+        gp_get_realtime(t0);
+        for (j = 0; j < reps; ++j)
+            for (i = 0; i < samples; ++i)
+                codes[k * samples + i] =
+                    fn_PtCr_evaluate((const gs_function_t *)pfn, in + i * m,
+                                     out + (k * samples + i) * n);
+        gp_get_realtime(t1);
+        t[k] = (t1[0] - t0[0]) * 1000000 + (t1[1] - t0[1]) / 1000;
+    }
+    pfn->code = code;
+    dmprintf5(mem, "PtCr function %4u bytes: interpreted %8.0f/ms  compiled %8.0f/ms  x%.2f  %s\n",
+              pfn->params.ops.size,
+              t[0] > 0 ? (double)samples * reps * 1000 / t[0] : 0.0,
+              t[1] > 0 ? (double)samples * reps * 1000 / t[1] : 0.0,
+              t[1] > 0 ? (double)t[0] / t[1] : 0.0,
+              memcmp(out, out + samples * n, samples * n * sizeof(float)) ||
+              memcmp(codes, codes + samples, samples * sizeof(int)) ?
+              "MISMATCH" : "ok");
+done:
+    gs_free_object(mem, in, "bench_PtCr_function");
+    gs_free_object(mem, out, "bench_PtCr_function");
+    gs_free_object(mem, codes, "bench_PtCr_function");
+}
+#endif
+
 /* Allocate and initialize a PostScript Calculator function. */
 int
 gs_function_PtCr_init(gs_function_t ** ppfn,
@@ -838,7 +2010,7 @@ gs_function_PtCr_init(gs_function_t ** ppfn,
             fn_common_get_params,
             (fn_make_scaled_proc_t) fn_PtCr_make_scaled,
             (fn_free_params_proc_t) gs_function_PtCr_free_params,
-            fn_common_free,
+            fn_PtCr_free,
             (fn_serialize_proc_t) gs_function_PtCr_serialize,
         }
     };
@@ -896,6 +2068,11 @@ gs_function_PtCr_init(gs_function_t ** ppfn,
         data_source_init_string2(&pfn->data_source, NULL, 0);
         pfn->data_source.access = calc_access;
         pfn->head = function_PtCr_head;
+        fn_PtCr_compile(pfn, mem);
+#ifdef BENCH_PTCR_FUNCTIONS
+        if (pfn->code != 0)
+            bench_PtCr_function(pfn, mem->non_gc_memory);
+#endif
         *ppfn = (gs_function_t *) pfn;
     }
     return 0;
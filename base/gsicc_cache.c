@@ -36,6 +36,9 @@
 #include "gzstate.h"
 #include "stdint_.h"
 #include "assert_.h"
+#include "gp.h"
+#include "gscdefs.h"
+#include "gssprintf.h"
         /*
          *  Note that the the external memory used to maintain
          *  links in the CMS is generally not visible to GS.
@@ -90,6 +93,26 @@ gs_private_st_ptrs3_final(st_icc_linkcache, gsicc_link_cache_t, "gsiccmanage_lin
 #define REND_SHIFT 8
 #define PRESERVE_SHIFT 16
 
+/* Persistent links.  If the ICCLinkCacheDir user parameter names a
+   directory, each link the CMM builds is also written there as a device link
+   profile, and later runs load it back rather than building it again.  The
+   header carries everything the link depends on; a file whose header does
+   not match is simply a miss (and is replaced by the next write). */
+
+#define ICC_LINK_FILE_MAGIC "GSICCLNK"
+#define ICC_LINK_FILE_VERSION 1
+
+typedef struct gsicc_link_file_header_s {
+    char magic[8];
+    int32_t version;
+    int32_t revision;		/* gs_revision of the writer */
+    int32_t cms_flags;
+    int32_t accuracy;		/* ColorAccuracy */
+    gsicc_hashlink_t hash;
+    int32_t graytok;		/* gray was mapped to K only */
+    uint32_t data_size;		/* size of the device link that follows */
+} gsicc_link_file_header_t;
+
 /**
  * gsicc_cache_new: Allocate a new ICC cache manager
  * Return value: Pointer to allocated manager, or NULL on failure.
@@ -110,6 +133,9 @@ gsicc_cache_new(gs_memory_t *memory)
     result->head = NULL;
     result->num_links = 0;
     result->cache_full = false;
+    result->file_hits = 0;
+    result->file_misses = 0;
+    result->file_writes = 0;
     result->memory = memory;
     result->full_wait = NULL; /* Required so finaliser can work when result freed. */
     rc_init_free(result, memory, 1, rc_gsicc_link_cache_free);
@@ -145,6 +171,11 @@ rc_gsicc_link_cache_free(gs_memory_t * mem, void *ptr_in, client_name_t cname)
     if_debug2m(gs_debug_flag_icc, link_cache->memory,
                "[icc] Removing link cache = "PRI_INTPTR" memory = "PRI_INTPTR"\n",
                (intptr_t)link_cache, (intptr_t)link_cache->memory);
+    if (link_cache->file_hits + link_cache->file_misses > 0)
+        if_debug3m(gs_debug_flag_icc, link_cache->memory,
+                   "[icc] Link cache dir: hits = %d, misses = %d, writes = %d\n",
+                   link_cache->file_hits, link_cache->file_misses,
+                   link_cache->file_writes);
     /* NB: freeing the link_cache will call icc_linkcache_finalize */
     gs_free_object(link_cache->memory, link_cache, "rc_gsicc_link_cache_free");
 }
@@ -966,6 +997,150 @@ gsicc_alloc_link_entry(gsicc_link_cache_t *icc_link_cache,
    deleting while someone is updating a reference count).  Note that if the
    source profile is a device link profile we have no output profile but
    may still have a proofing or another device link profile to use */
+static void
+gsicc_link_file_key(gsicc_link_file_header_t *key, gsicc_hashlink_t *hash,
+                    int cms_flags, bool graytok, gs_memory_t *memory)
+{
+    memset(key, 0, sizeof(*key));
+    memcpy(key->magic, ICC_LINK_FILE_MAGIC, sizeof(key->magic));
+    key->version = ICC_LINK_FILE_VERSION;
+    key->revision = gs_revision;
+    key->cms_flags = cms_flags;
+    key->accuracy = gs_lib_ctx_get_interp_instance(memory)->icc_color_accuracy;
+    key->hash = *hash;
+    key->graytok = graytok;
+}
+
+/* Returns false if there is no link cache directory */
+static bool
+gsicc_link_file_name(const gsicc_link_file_header_t *key, char *fname,
+                     int len, gs_memory_t *memory)
+{
+    const gs_lib_ctx_t *ctx = memory->gs_lib_ctx;
+    const char *sep = "";
+
+    if (ctx->linkcachedir == NULL || ctx->linkcachedir_len == 0)
+        return false;
+    if (ctx->linkcachedir[ctx->linkcachedir_len - 1] != '/' &&
+        ctx->linkcachedir[ctx->linkcachedir_len - 1] != '\\')
+        sep = gp_file_name_directory_separator();
+    return gs_snprintf(fname, len, "%s%sgsicc_%016"PRIx64"_%x_%x_%d.icl",
+                       ctx->linkcachedir, sep,
+                       (uint64_t)key->hash.link_hashcode, key->cms_flags,
+                       key->accuracy, key->graytok) < len - 1;
+}
+
+static void
+gsicc_link_file_count(gsicc_link_cache_t *icc_link_cache, int *counter)
+{
+    gx_monitor_enter(icc_link_cache->lock);
+    (*counter)++;
+    gx_monitor_leave(icc_link_cache->lock);
+}
+
+/* Look for the link in the link cache directory.  The file is mapped
+   rather than read where the platform allows.  The profiles are those
+   the link would otherwise be built from. */
+static gcmmhlink_t
+gsicc_link_file_load(gsicc_link_cache_t *icc_link_cache,
+                     const gsicc_link_file_header_t *key,
+                     gcmmhprofile_t cms_input_profile,
+                     gcmmhprofile_t cms_output_profile, gs_memory_t *memory)
+{
+    char fname[gp_file_name_sizeof];
+    gsicc_link_file_header_t header;
+    gp_file *fid;
+    gs_offset_t size = 0;
+    const byte *data = NULL;
+    byte *buffer = NULL;
+    gcmmhlink_t link_handle = NULL;
+
+    if (!gsicc_link_file_name(key, fname, sizeof(fname), memory))
+        return NULL;
+    fid = gp_fopen_unchecked(memory, fname, "rb");
+    if (fid != NULL) {
+        if (gp_fread(&header, 1, sizeof(header), fid) == sizeof(header) &&
+            memcmp(&header, key, offsetof(gsicc_link_file_header_t, data_size)) == 0 &&
+            gp_fseek(fid, 0, SEEK_END) == 0) {
+            size = gp_ftell(fid);
+            if (size == sizeof(header) + (gs_offset_t)header.data_size) {
+                data = gp_fmap(fid, size);
+                if (data == NULL) {
+                    buffer = gs_alloc_bytes(memory, header.data_size,
+                                            "gsicc_link_file_load");
+                    if (buffer != NULL &&
+                        (gp_fseek(fid, sizeof(header), SEEK_SET) != 0 ||
+                         gp_fread(buffer, 1, header.data_size, fid) != header.data_size)) {
+                        gs_free_object(memory, buffer, "gsicc_link_file_load");
+                        buffer = NULL;
+                    }
+                }
+            }
+        }
+        gp_fclose(fid);
+    }
+    if (data != NULL) {
+        link_handle = gscms_get_link_from_data(data + sizeof(header),
+                                               header.data_size,
+                                               cms_input_profile,
+                                               cms_output_profile, 0, memory);
+        gp_funmap(data, size);
+    } else if (buffer != NULL) {
+        link_handle = gscms_get_link_from_data(buffer, header.data_size,
+                                               cms_input_profile,
+                                               cms_output_profile, 0, memory);
+        gs_free_object(memory, buffer, "gsicc_link_file_load");
+    }
+    if (link_handle != NULL) {
+        gsicc_link_file_count(icc_link_cache, &icc_link_cache->file_hits);
+        if_debug1m(gs_debug_flag_icc, memory, "[icc] Loaded link %s\n", fname);
+    } else {
+        gsicc_link_file_count(icc_link_cache, &icc_link_cache->file_misses);
+    }
+    return link_handle;
+}
+
+/* Add a newly built link to the link cache directory.  It is written to
+   a private name first and renamed, so concurrent runs never see a
+   partial file. */
+static void
+gsicc_link_file_store(gsicc_link_cache_t *icc_link_cache,
+                      const gsicc_link_file_header_t *key,
+                      gcmmhlink_t link_handle, gs_memory_t *memory)
+{
+    char fname[gp_file_name_sizeof];
+    char tmpname[gp_file_name_sizeof];
+    gsicc_link_file_header_t header = *key;
+    unsigned char *data;
+    unsigned int size;
+    gp_file *fid;
+    long now[2];
+    bool ok;
+
+    if (!gsicc_link_file_name(key, fname, sizeof(fname), memory))
+        return;
+    gp_get_realtime(now);
+    if (gs_snprintf(tmpname, sizeof(tmpname), "%s.%lx%lx", fname, now[1],
+                    (long)(intptr_t)link_handle) >= (int)sizeof(tmpname) - 1)
+        return;
+    if (gscms_get_link_data(link_handle, &data, &size, memory) < 0)
+        return;
+    header.data_size = size;
+    fid = gp_fopen_unchecked(memory, tmpname, "wb");
+    if (fid != NULL) {
+        ok = gp_fwrite(&header, 1, sizeof(header), fid) == sizeof(header) &&
+             gp_fwrite(data, 1, size, fid) == size;
+        ok = (gp_fclose(fid) == 0) && ok;
+        if (ok && gp_rename_unchecked(memory, tmpname, fname) == 0) {
+            gsicc_link_file_count(icc_link_cache, &icc_link_cache->file_writes);
+            if_debug1m(gs_debug_flag_icc, memory, "[icc] Saved link %s\n", fname);
+        } else {
+            gp_unlink_unchecked(memory, tmpname);
+        }
+    }
+    gs_free_object(memory->non_gc_memory, data, "gsicc_link_file_store");
+}
+
 gsicc_link_t*
 gsicc_get_link_profile(const gs_gstate *pgs, gx_device *dev,
                        cmm_profile_t *gs_input_profile,
@@ -991,6 +1166,7 @@ gsicc_get_link_profile(const gs_gstate *pgs, gx_device *dev,
     cmm_profile_t *devlink_profile = NULL;
     bool src_dev_link = gs_input_profile->isdevlink;
     bool pageneutralcolor = false;
+    bool graytok = false;
     int cms_flags = 0;
 
     /* Determine if we are using a soft proof or device link profile */
@@ -1245,6 +1421,7 @@ gsicc_get_link_profile(const gs_gstate *pgs, gx_device *dev,
         /* Turn off bp compensation in this case as there is a bug in lcms */
         rendering_params->black_point_comp = false;
         cms_flags = 0;  /* Turn off any flag setting */
+        graytok = true;
     }
     /* Get the link with the proof and or device link profile */
     if (include_softproof || include_devicelink || src_dev_link) {
@@ -1264,9 +1441,20 @@ gsicc_get_link_profile(const gs_gstate *pgs, gx_device *dev,
         }
     }
     } else {
-        link_handle = gscms_get_link(cms_input_profile, cms_output_profile,
-                                     rendering_params, cms_flags,
-                                     cache_mem->non_gc_memory);
+        gsicc_link_file_header_t link_key;
+
+        gsicc_link_file_key(&link_key, &hash, cms_flags, graytok, memory);
+        link_handle = gsicc_link_file_load(icc_link_cache, &link_key,
+                                           cms_input_profile, cms_output_profile,
+                                           cache_mem->non_gc_memory);
+        if (link_handle == NULL) {
+            link_handle = gscms_get_link(cms_input_profile, cms_output_profile,
+                                         rendering_params, cms_flags,
+                                         cache_mem->non_gc_memory);
+            if (link_handle != NULL)
+                gsicc_link_file_store(icc_link_cache, &link_key, link_handle,
+                                      cache_mem->non_gc_memory);
+        }
     }
     if (!gscms_is_threadsafe()) {
         if (!src_dev_link) {
@@ -76,6 +76,13 @@ gcmmhlink_t gscms_get_link_proof_devlink(gcmmhprofile_t lcms_srchandle,
                                          gsicc_rendering_param_t *rendering_params,
                                          bool src_dev_link, int cmm_flags,
                                          gs_memory_t *memory);
+int gscms_get_link_data(gcmmhlink_t link, unsigned char **pdata,
+                        unsigned int *psize, gs_memory_t *memory);
+gcmmhlink_t gscms_get_link_from_data(const unsigned char *data,
+                                     unsigned int size,
+                                     gcmmhprofile_t lcms_srchandle,
+                                     gcmmhprofile_t lcms_deshandle,
+                                     int cmm_flags, gs_memory_t *memory);
 void *gscms_create(gs_memory_t *memory);
 void gscms_destroy(void *);
 void gscms_release_link(gsicc_link_t *icclink);
@@ -730,6 +730,26 @@ gscms_get_link_proof_devlink(gcmmhprofile_t lcms_srchandle,
     }
 }
 
+/* Links are only kept on disk with lcms2mt, which can reload them
+   exactly (see gsicc_lcms2mt.c) */
+int
+gscms_get_link_data(gcmmhlink_t link, unsigned char **pdata,
+                    unsigned int *psize, gs_memory_t *memory)
+{
+    *pdata = NULL;
+    *psize = 0;
+    return_error(gs_error_undefined);
+}
+
+gcmmhlink_t
+gscms_get_link_from_data(const unsigned char *data, unsigned int size,
+                         gcmmhprofile_t lcms_srchandle,
+                         gcmmhprofile_t lcms_deshandle,
+                         int cmm_flags, gs_memory_t *memory)
+{
+    return NULL;
+}
+
 /* Do any initialization if needed to the CMS */
 void *
 gscms_create(gs_memory_t *memory)
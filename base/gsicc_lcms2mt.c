@@ -28,6 +28,9 @@
 #ifdef WITH_CAL
 #include "cal.h"
 #endif
+#ifdef HAVE_SSE2
+#include <emmintrin.h>
+#endif
 
 #define USE_LCMS2_LOCKING
 
@@ -46,9 +49,12 @@
      (endianswapIN != 0) << 3 | (endianswapOUT != 0) << 2 | \
      (bytesIN == 1) << 1 | (bytesOUT == 1))
 
+typedef struct gscms_image_clut_s gscms_image_clut_t;
+
 typedef struct gsicc_lcms2mt_link_list_s {
     int flags;
     cmsHTRANSFORM *hTransform;
+    gscms_image_clut_t *image_clut;	/* only ever on the first entry */
     struct gsicc_lcms2mt_link_list_s *next;
 } gsicc_lcms2mt_link_list_t;
 
@@ -328,6 +334,342 @@ gscms_get_profile_handle_file(const char *filename, gs_memory_t *mem)
     return cmsOpenProfileFromFile(ctx, filename, "r");
 }
 
+/* Image CLUT fast path.
+
+   For 8 bit, 3 component, chunky image data (RGB photos, mostly) the
+   per pixel overhead of going through lcms is significant.  If the user
+   asks for it with -dImageCLUTDeltaE=<n>, each such link also gets a
+   grid of 17^3 nodes (33^3 at the highest ColorAccuracy) sampled from
+   the transform, which is evaluated with tetrahedral interpolation in
+   integer arithmetic, 4 channels at a time with SSE2.  The grid is only
+   used if, at a sample of points between its nodes, it stays within
+   <n> (CIE76 delta E, in the destination profile's colour space) of the
+   full transform.
+
+   The nodes are held to 15 bits so that differences between them fit
+   in 16 bit lanes, and the weights are in 1/256ths.  The scalar and SSE2
+   code do exactly the same sums and so give the same results. */
+#define IMAGE_CLUT_MAX_OUT GS_CLIENT_COLOR_MAX_COMPONENTS
+#define IMAGE_CLUT_TEST_POINTS 16	/* per axis */
+
+struct gscms_image_clut_s {
+    int grid;			/* nodes per axis */
+    int num_out;
+    int node_size;		/* entries per node */
+    unsigned short *table;
+    int offset[3][256];		/* node below each input value */
+    int step[3][256];		/* to the node above, 0 at the top */
+    int weight[256];		/* 0..256 */
+};
+
+static inline void
+gscms_image_clut_cell(const gscms_image_clut_t *clut, const byte *in,
+                      const unsigned short **p, int *w)
+{
+    int r = in[0], g = in[1], b = in[2];
+    int wr = clut->weight[r], wg = clut->weight[g], wb = clut->weight[b];
+    int sr = clut->step[0][r], sg = clut->step[1][g], sb = clut->step[2][b];
+
+    p[0] = clut->table + clut->offset[0][r] + clut->offset[1][g] + clut->offset[2][b];
+    /* Pick the tetrahedron, i.e. visit the axes in decreasing weight */
+    if (wr >= wg) {
+        if (wg >= wb) {
+            w[0] = wr, w[1] = wg, w[2] = wb;
+            p[1] = p[0] + sr, p[2] = p[1] + sg;
+        } else if (wr >= wb) {
+            w[0] = wr, w[1] = wb, w[2] = wg;
+            p[1] = p[0] + sr, p[2] = p[1] + sb;
+        } else {
+            w[0] = wb, w[1] = wr, w[2] = wg;
+            p[1] = p[0] + sb, p[2] = p[1] + sr;
+        }
+    } else {
+        if (wr >= wb) {
+            w[0] = wg, w[1] = wr, w[2] = wb;
+            p[1] = p[0] + sg, p[2] = p[1] + sr;
+        } else if (wg >= wb) {
+            w[0] = wg, w[1] = wb, w[2] = wr;
+            p[1] = p[0] + sg, p[2] = p[1] + sb;
+        } else {
+            w[0] = wb, w[1] = wg, w[2] = wr;
+            p[1] = p[0] + sb, p[2] = p[1] + sg;
+        }
+    }
+    p[3] = p[0] + sr + sg + sb;
+}
+
+/* Interpolate one pixel giving 15 bit values */
+static inline void
+gscms_image_clut_interp(const gscms_image_clut_t *clut, const byte *in,
+                        int *out)
+{
+    const unsigned short *p[4];
+    int w[3], k;
+
+    gscms_image_clut_cell(clut, in, p, w);
+    for (k = 0; k < clut->num_out; k++)
+        out[k] = ((p[0][k] << 8) + w[0] * (p[1][k] - p[0][k]) +
+                  w[1] * (p[2][k] - p[1][k]) + w[2] * (p[3][k] - p[2][k]) +
+                  128) >> 8;
+}
+
+#define IMAGE_CLUT_TO_8(v) ((((v) << 8) - (v) + 16384) >> 15)
+#define IMAGE_CLUT_TO_16(v) (((v) << 1) | ((v) >> 14))
+
+static void
+gscms_image_clut_row(const gscms_image_clut_t *clut, const byte *in,
+                     byte *out, int num_pixels, int bytes_out,
+                     int planar, int plane_stride)
+{
+    int out_vals[IMAGE_CLUT_MAX_OUT];
+    int num_out = clut->num_out;
+    int x, k;
+
+#ifdef HAVE_SSE2
+    if (bytes_out == 1 && clut->node_size == 4) {
+        const __m128i round = _mm_set1_epi32(128);
+        const __m128i half = _mm_set1_epi32(16384);
+        const unsigned short *p[4];
+        int w[3];
+        __m128i c0, c1, c2, c3, v;
+        byte vals[16];
+
+        for (x = 0; x < num_pixels; x++, in += 3) {
+            gscms_image_clut_cell(clut, in, p, w);
+            c0 = _mm_loadl_epi64((const __m128i *)p[0]);
+            c1 = _mm_loadl_epi64((const __m128i *)p[1]);
+            c2 = _mm_loadl_epi64((const __m128i *)p[2]);
+            c3 = _mm_loadl_epi64((const __m128i *)p[3]);
+            /* w0 * (c1 - c0) + w1 * (c2 - c1) + w2 * (c3 - c2) + 256 * c0 */
+            v = _mm_add_epi32(
+                    _mm_madd_epi16(_mm_unpacklo_epi16(_mm_sub_epi16(c1, c0),
+                                                      _mm_sub_epi16(c2, c1)),
+                                   _mm_set1_epi32(w[0] | (w[1] << 16))),
+                    _mm_madd_epi16(_mm_unpacklo_epi16(_mm_sub_epi16(c3, c2), c0),
+                                   _mm_set1_epi32(w[2] | (256 << 16))));
+            v = _mm_srli_epi32(_mm_add_epi32(v, round), 8);
+            /* IMAGE_CLUT_TO_8 */
+            v = _mm_srli_epi32(_mm_add_epi32(_mm_sub_epi32(_mm_slli_epi32(v, 8), v),
+                                             half), 15);
+            v = _mm_packs_epi32(v, v);
+            v = _mm_packus_epi16(v, v);
+            if (planar) {
+                _mm_storeu_si128((__m128i *)vals, v);
+                for (k = 0; k < num_out; k++)
+                    out[k * plane_stride] = vals[k];
+                out++;
+            } else if (num_out == 4) {
+                int v32 = _mm_cvtsi128_si32(v);
+
+                memcpy(out, &v32, 4);
+                out += 4;
+            } else {
+                _mm_storeu_si128((__m128i *)vals, v);
+                for (k = 0; k < num_out; k++)
+                    *out++ = vals[k];
+            }
+        }
+        return;
+    }
+#endif
+    for (x = 0; x < num_pixels; x++, in += 3) {
+        gscms_image_clut_interp(clut, in, out_vals);
+        if (bytes_out == 1) {
+            if (planar) {
+                for (k = 0; k < num_out; k++)
+                    out[k * plane_stride] = IMAGE_CLUT_TO_8(out_vals[k]);
+                out++;
+            } else {
+                for (k = 0; k < num_out; k++)
+                    *out++ = IMAGE_CLUT_TO_8(out_vals[k]);
+            }
+        } else {
+            unsigned short *out16 = (unsigned short *)out;
+
+            if (planar) {
+                for (k = 0; k < num_out; k++)
+                    out16[k * (plane_stride >> 1)] = IMAGE_CLUT_TO_16(out_vals[k]);
+                out += 2;
+            } else {
+                for (k = 0; k < num_out; k++)
+                    out16[k] = IMAGE_CLUT_TO_16(out_vals[k]);
+                out += 2 * num_out;
+            }
+        }
+    }
+}
+
+static void
+gscms_image_clut_free(gscms_image_clut_t *clut, gs_memory_t *memory)
+{
+    if (clut == NULL)
+        return;
+    gs_free_object(memory->non_gc_memory, clut->table, "gscms_image_clut_free");
+    gs_free_object(memory->non_gc_memory, clut, "gscms_image_clut_free");
+}
+
+/* Build the grid for a link from a 3 component space, returning NULL if
+   it can't be built or isn't accurate enough. des_to_lab takes the 16 bit
+   output of the link to Lab doubles. */
+static gscms_image_clut_t *
+gscms_image_clut_new(cmsContext ctx, cmsHTRANSFORM hTransform,
+                     cmsHTRANSFORM des_to_lab, int num_out,
+                     double max_delta_e, gs_memory_t *memory)
+{
+    gs_memory_t *mem = memory->non_gc_memory;
+    gscms_image_clut_t *clut;
+    int grid = gs_lib_ctx_get_interp_instance(memory)->icc_color_accuracy >= 2 ? 33 : 17;
+    int num_nodes = grid * grid * grid;
+    int num_test = IMAGE_CLUT_TEST_POINTS * IMAGE_CLUT_TEST_POINTS *
+                   IMAGE_CLUT_TEST_POINTS;
+    int test_step = (grid - 1) / IMAGE_CLUT_TEST_POINTS;
+    int num_vals = num_nodes > num_test * 2 ? num_nodes : num_test * 2;
+    unsigned short *buf_in = NULL, *buf_out = NULL;
+    cmsCIELab *lab = NULL;
+    byte test_in[3];
+    int out_vals[IMAGE_CLUT_MAX_OUT];
+    double delta_e, worst = 0;
+    int c, i, j, k, n, v;
+
+    if (num_out > IMAGE_CLUT_MAX_OUT)
+        return NULL;
+    clut = (gscms_image_clut_t *)gs_alloc_bytes(mem, sizeof(gscms_image_clut_t),
+                                                 "gscms_image_clut_new");
+    if (clut == NULL)
+        return NULL;
+    clut->grid = grid;
+    clut->num_out = num_out;
+    /* Pad to 4 so that the SSE2 code can load a node at once */
+    clut->node_size = num_out <= 4 ? 4 : num_out;
+    clut->table = (unsigned short *)gs_alloc_bytes(mem,
+                        (size_t)num_nodes * clut->node_size * sizeof(unsigned short),
+                        "gscms_image_clut_new");
+    buf_in = (unsigned short *)gs_alloc_bytes(mem, (size_t)num_vals * 3 * sizeof(unsigned short),
+                                               "gscms_image_clut_new");
+    buf_out = (unsigned short *)gs_alloc_bytes(mem, (size_t)num_vals * num_out * sizeof(unsigned short),
+                                                "gscms_image_clut_new");
+    lab = (cmsCIELab *)gs_alloc_bytes(mem, (size_t)num_test * 2 * sizeof(cmsCIELab),
+                                      "gscms_image_clut_new");
+    if (clut->table == NULL || buf_in == NULL || buf_out == NULL || lab == NULL)
+        goto fail;
+
+    for (v = 0; v < 256; v++) {
+        int pos = v * (grid - 1);
+
+        n = pos / 255;
+        clut->weight[v] = ((pos % 255) * 256 + 127) / 255;
+        for (c = 0; c < 3; c++) {
+            int stride = clut->node_size * (c == 0 ? grid * grid : c == 1 ? grid : 1);
+
+            clut->offset[c][v] = n * stride;
+            clut->step[c][v] = n < grid - 1 ? stride : 0;
+        }
+    }
+
+    /* Sample the nodes */
+    n = 0;
+    for (i = 0; i < grid; i++)
+        for (j = 0; j < grid; j++)
+            for (k = 0; k < grid; k++) {
+                buf_in[n++] = (i * 65535 + (grid - 1) / 2) / (grid - 1);
+                buf_in[n++] = (j * 65535 + (grid - 1) / 2) / (grid - 1);
+                buf_in[n++] = (k * 65535 + (grid - 1) / 2) / (grid - 1);
+            }
+    cmsDoTransform(ctx, hTransform, buf_in, buf_out, num_nodes);
+    for (n = 0; n < num_nodes; n++) {
+        for (c = 0; c < num_out; c++)
+            clut->table[n * clut->node_size + c] = buf_out[n * num_out + c] >> 1;
+        for (; c < clut->node_size; c++)
+            clut->table[n * clut->node_size + c] = 0;
+    }
+
+    /* Check it at the middle of (a sample of) its cells against the
+       transform itself.  The first num_test colours are from the link,
+       the rest from the grid. */
+    n = 0;
+    for (i = 0; i < IMAGE_CLUT_TEST_POINTS; i++)
+        for (j = 0; j < IMAGE_CLUT_TEST_POINTS; j++)
+            for (k = 0; k < IMAGE_CLUT_TEST_POINTS; k++) {
+                int cell[3];
+
+                cell[0] = i, cell[1] = j, cell[2] = k;
+                for (c = 0; c < 3; c++) {
+                    int m = cell[c] * test_step;
+
+                    v = ((2 * m + 1) * 255 + grid - 1) / (2 * (grid - 1));
+                    test_in[c] = v;
+                    buf_in[n * 3 + c] = v * 257;
+                }
+                gscms_image_clut_interp(clut, test_in, out_vals);
+                for (c = 0; c < num_out; c++)
+                    buf_out[(num_test + n) * num_out + c] = IMAGE_CLUT_TO_16(out_vals[c]);
+                n++;
+            }
+    cmsDoTransform(ctx, hTransform, buf_in, buf_out, num_test);
+    cmsDoTransform(ctx, des_to_lab, buf_out, lab, num_test * 2);
+    for (n = 0; n < num_test; n++) {
+        delta_e = cmsDeltaE(ctx, &lab[n], &lab[num_test + n]);
+        if (delta_e > worst)
+            worst = delta_e;
+    }
+    if_debug3m(gs_debug_flag_icc, memory,
+               "[icc] Image CLUT %d^3, worst delta E %g: %s\n", grid, worst,
+               worst <= max_delta_e ? "using it" : "not used");
+    if (worst > max_delta_e)
+        goto fail;
+    gs_free_object(mem, lab, "gscms_image_clut_new");
+    gs_free_object(mem, buf_out, "gscms_image_clut_new");
+    gs_free_object(mem, buf_in, "gscms_image_clut_new");
+    return clut;
+
+fail:
+    gs_free_object(mem, lab, "gscms_image_clut_new");
+    gs_free_object(mem, buf_out, "gscms_image_clut_new");
+    gs_free_object(mem, buf_in, "gscms_image_clut_new");
+    gscms_image_clut_free(clut, memory);
+    return NULL;
+}
+
+/* Add the image CLUT to a new link if it has been asked for and the
+   link is one it can do */
+static void
+gscms_image_clut_add(cmsContext ctx, gsicc_lcms2mt_link_list_t *link_handle,
+                     cmsHPROFILE lcms_srchandle, cmsHPROFILE lcms_deshandle,
+                     gs_memory_t *memory)
+{
+    float max_delta_e = gs_lib_ctx_get_interp_instance(memory)->icc_image_clut_delta_e;
+    cmsColorSpaceSignature des_space;
+    cmsHPROFILE lab_profile;
+    cmsHTRANSFORM des_to_lab;
+    cmsUInt32Number des_format;
+
+    link_handle->image_clut = NULL;
+    if (max_delta_e <= 0 || lcms_deshandle == NULL ||
+        cmsGetDeviceClass(ctx, lcms_srchandle) == cmsSigLinkClass ||
+        cmsGetDeviceClass(ctx, lcms_deshandle) == cmsSigLinkClass ||
+        cmsChannelsOf(ctx, cmsGetColorSpace(ctx, lcms_srchandle)) != 3 ||
+        cmsGetColorSpace(ctx, lcms_srchandle) == cmsSigLabData)
+        return;
+    des_space = cmsGetColorSpace(ctx, lcms_deshandle);
+    if (des_space == cmsSigLabData || des_space == cmsSigXYZData)
+        return;
+    lab_profile = cmsCreateLab4Profile(ctx, NULL);
+    if (lab_profile == NULL)
+        return;
+    des_format = cmsGetTransformOutputFormat(ctx, link_handle->hTransform);
+    des_to_lab = cmsCreateTransform(ctx, lcms_deshandle, des_format,
+                                    lab_profile, TYPE_Lab_DBL,
+                                    INTENT_RELATIVE_COLORIMETRIC,
+                                    cmsFLAGS_NOCACHE);
+    cmsCloseProfile(ctx, lab_profile);
+    if (des_to_lab == NULL)
+        return;
+    link_handle->image_clut = gscms_image_clut_new(ctx, link_handle->hTransform,
+                                  des_to_lab, T_CHANNELS(des_format),
+                                  max_delta_e, memory);
+    cmsDeleteTransform(ctx, des_to_lab);
+}
+
 /* Transform an entire buffer */
 int
 gscms_transform_color_buffer(gx_device *dev, gsicc_link_t *icclink,
@@ -376,6 +718,24 @@ gscms_transform_color_buffer(gx_device *dev, gsicc_link_t *icclink,
     /* This is really only going to be an issue when we have interleaved alpha data */
     hasalpha = input_buff_desc->has_alpha;
 
+    if (link_handle->image_clut != NULL && numbytesIN == 1 && !hasalpha &&
+        !planarIN && !swap_endianOUT &&
+        input_buff_desc->num_chan == 3 &&
+        output_buff_desc->num_chan == link_handle->image_clut->num_out) {
+        int y;
+
+        inputpos = (byte *) inputbuffer;
+        outputpos = (byte *) outputbuffer;
+        for (y = 0; y < input_buff_desc->num_rows; y++) {
+            gscms_image_clut_row(link_handle->image_clut, inputpos, outputpos,
+                                 input_buff_desc->pixels_per_row, numbytesOUT,
+                                 planarOUT, output_buff_desc->plane_stride);
+            inputpos += input_buff_desc->row_stride;
+            outputpos += output_buff_desc->row_stride;
+        }
+        return 0;
+    }
+
     needed_flags = gsicc_link_flags(hasalpha, planarIN, planarOUT,
                                     swap_endianIN, swap_endianOUT,
                                     numbytesIN, numbytesOUT);
@@ -398,6 +758,7 @@ gscms_transform_color_buffer(gx_device *dev, gsicc_link_t *icclink,
             return_error(gs_error_VMerror);
         }
         new_link_handle->next = NULL;		/* new end of list */
+        new_link_handle->image_clut = NULL;
         new_link_handle->flags = needed_flags;
         hTransform = link_handle->hTransform;	/* doesn't really matter which we start with */
         /* Color space MUST be the same */
@@ -519,6 +880,7 @@ gscms_transform_color_const(const gx_device *dev, gsicc_link_t *icclink, void *i
             return_error(gs_error_VMerror);
         }
         new_link_handle->next = NULL;		/* new end of list */
+        new_link_handle->image_clut = NULL;
         new_link_handle->flags = needed_flags;
         hTransform = link_handle->hTransform;
 
@@ -699,6 +1061,7 @@ gscms_get_link(gcmmhprofile_t  lcms_srchandle, gcmmhprofile_t lcms_deshandle,
     link_handle->next = NULL;
     link_handle->flags = gsicc_link_flags(0, 0, 0, 0, 0,    /* no alpha, not planar, no endian swap */
                                           sizeof(gx_color_value), sizeof(gx_color_value));
+    gscms_image_clut_add(ctx, link_handle, lcms_srchandle, lcms_deshandle, memory);
     return link_handle;
     /* cmsFLAGS_HIGHRESPRECALC)  cmsFLAGS_NOTPRECALC  cmsFLAGS_LOWRESPRECALC*/
 }
@@ -731,6 +1094,7 @@ gscms_get_link_proof_devlink(gcmmhprofile_t lcms_srchandle,
                                                          "gscms_transform_color_buffer");
     if (link_handle == NULL)
          return NULL;
+    link_handle->image_clut = NULL;
     link_handle->next = NULL;
     link_handle->flags = gsicc_link_flags(0, 0, 0, 0, 0,    /* no alpha, not planar, no endian swap */
                                           sizeof(gx_color_value), sizeof(gx_color_value));
@@ -876,6 +1240,171 @@ gscms_get_link_proof_devlink(gcmmhprofile_t lcms_srchandle,
     return link_handle;
 }
 
+/* Links kept on disk (see gsicc_cache.c) are device link profiles holding
+   the CLUT of the original transform between identity curves.  Letting
+   lcms optimise such a profile again would resample the CLUT, which costs
+   as much as building the link in the first place and moves values off
+   the grid by a unit here and there.  This optimisation plugin instead
+   evaluates the stored CLUT directly, exactly as lcms' own resampling
+   optimisation evaluates the CLUT it builds.  It only acts when asked to
+   with GSCMS_FLAGS_STORED_LINK. */
+#define GSCMS_FLAGS_STORED_LINK 0x80000000
+
+static cmsBool
+gscms_optimize_stored_link(cmsContext ctx, cmsPipeline **lut,
+                           cmsUInt32Number intent, cmsUInt32Number *input_format,
+                           cmsUInt32Number *output_format, cmsUInt32Number *flags)
+{
+    cmsStage *mpe;
+    _cmsStageCLutData *clut = NULL;
+    _cmsStageToneCurvesData *curves;
+    cmsUInt32Number k;
+
+    if (!(*flags & GSCMS_FLAGS_STORED_LINK) ||
+        T_FLOAT(*input_format) || T_FLOAT(*output_format) ||
+        T_BYTES(*input_format) == 1)
+        return FALSE;
+    for (mpe = cmsPipelineGetPtrToFirstStage(ctx, *lut); mpe != NULL;
+         mpe = cmsStageNext(ctx, mpe)) {
+        switch (cmsStageType(ctx, mpe)) {
+            case cmsSigCurveSetElemType:
+                curves = (_cmsStageToneCurvesData *)cmsStageData(ctx, mpe);
+                for (k = 0; k < curves->nCurves; k++)
+                    if (!cmsIsToneCurveLinear(ctx, curves->TheCurves[k]))
+                        return FALSE;
+                break;
+            case cmsSigCLutElemType:
+                if (clut != NULL)
+                    return FALSE;
+                clut = (_cmsStageCLutData *)cmsStageData(ctx, mpe);
+                if (clut->HasFloatValues)
+                    return FALSE;
+                break;
+            default:
+                return FALSE;
+        }
+    }
+    if (clut == NULL)
+        return FALSE;
+    /* A device link can only hold the CLUT between curves */
+    mpe = cmsPipelineGetPtrToFirstStage(ctx, *lut);
+    if (cmsStageType(ctx, mpe) != cmsSigCurveSetElemType &&
+        !cmsPipelineInsertStage(ctx, *lut, cmsAT_BEGIN,
+             cmsStageAllocToneCurves(ctx, cmsPipelineInputChannels(ctx, *lut), NULL)))
+        return FALSE;
+    mpe = cmsPipelineGetPtrToLastStage(ctx, *lut);
+    if (cmsStageType(ctx, mpe) != cmsSigCurveSetElemType &&
+        !cmsPipelineInsertStage(ctx, *lut, cmsAT_END,
+             cmsStageAllocToneCurves(ctx, cmsPipelineOutputChannels(ctx, *lut), NULL)))
+        return FALSE;
+    _cmsPipelineSetOptimizationParameters(ctx, *lut,
+                    (_cmsPipelineEval16Fn)clut->Params->Interpolation.Lerp16,
+                    clut->Params, NULL, NULL);
+    return TRUE;
+}
+
+static cmsPluginOptimization gs_cms_stored_link_handler =
+{
+    {
+        cmsPluginMagicNumber,
+        LCMS_VERSION,
+        cmsPluginOptimizationSig,
+        NULL
+    },
+    gscms_optimize_stored_link
+};
+
+/* Serialise a link so that it can be kept on disk and rebuilt with
+   gscms_get_link_from_data.  Only links that lcms reduced to a single
+   16 bit CLUT between device spaces are handled, as those are the ones
+   that are both costly to build and can be reloaded exactly.  The data
+   is allocated in non-gc memory and is owned by the caller. */
+int
+gscms_get_link_data(gcmmhlink_t link, unsigned char **pdata,
+                    unsigned int *psize, gs_memory_t *memory)
+{
+    cmsContext ctx = gs_lib_ctx_get_cms_context(memory);
+    gsicc_lcms2mt_link_list_t *link_handle = (gsicc_lcms2mt_link_list_t *)(link);
+    cmsHPROFILE devlink;
+    cmsPipeline *lut;
+    cmsStage *mpe;
+    cmsColorSpaceSignature cs;
+    cmsUInt32Number size = 0;
+    unsigned char *data = NULL;
+    int num_clut = 0;
+
+    *pdata = NULL;
+    *psize = 0;
+    devlink = cmsTransform2DeviceLink(ctx, link_handle->hTransform, 4.3,
+                                      GSCMS_FLAGS_STORED_LINK |
+                                      cmsFLAGS_NOWHITEONWHITEFIXUP);
+    if (devlink == NULL)
+        return_error(gs_error_unknownerror);
+    lut = (cmsPipeline *)cmsReadTag(ctx, devlink, cmsSigAToB0Tag);
+    if (lut != NULL) {
+        for (mpe = cmsPipelineGetPtrToFirstStage(ctx, lut); mpe != NULL;
+             mpe = cmsStageNext(ctx, mpe)) {
+            if (cmsStageType(ctx, mpe) == cmsSigCLutElemType)
+                num_clut++;
+            else if (cmsStageType(ctx, mpe) != cmsSigCurveSetElemType)
+                num_clut = 2;
+        }
+    }
+    cs = cmsGetColorSpace(ctx, devlink);
+    if (cs == cmsSigLabData || cs == cmsSigXYZData)
+        num_clut = 0;
+    cs = cmsGetPCS(ctx, devlink);
+    if (cs == cmsSigLabData || cs == cmsSigXYZData)
+        num_clut = 0;
+    if (num_clut == 1 && cmsSaveProfileToMem(ctx, devlink, NULL, &size) && size > 0) {
+        data = gs_alloc_bytes(memory->non_gc_memory, size, "gscms_get_link_data");
+        if (data != NULL && !cmsSaveProfileToMem(ctx, devlink, data, &size)) {
+            gs_free_object(memory->non_gc_memory, data, "gscms_get_link_data");
+            data = NULL;
+        }
+    }
+    cmsCloseProfile(ctx, devlink);
+    if (data == NULL)
+        return num_clut == 1 ? gs_note_error(gs_error_VMerror) :
+                               gs_note_error(gs_error_rangecheck);
+    *pdata = data;
+    *psize = size;
+    return 0;
+}
+
+/* Rebuild a link from the data returned by gscms_get_link_data. The
+   device link already has the original intent, black point and white
+   point handling baked in, so none of that is applied a second time.
+   The source and destination profiles the link was built from are
+   needed to set up the image CLUT, just as for a new link. */
+gcmmhlink_t
+gscms_get_link_from_data(const unsigned char *data, unsigned int size,
+                         gcmmhprofile_t lcms_srchandle,
+                         gcmmhprofile_t lcms_deshandle,
+                         int cmm_flags, gs_memory_t *memory)
+{
+    cmsContext ctx = gs_lib_ctx_get_cms_context(memory);
+    gsicc_rendering_param_t rendering_params;
+    gcmmhprofile_t devlink;
+    gcmmhlink_t link;
+
+    devlink = gscms_get_profile_handle_mem((unsigned char *)data, size, memory);
+    if (devlink == NULL)
+        return NULL;
+    memset(&rendering_params, 0, sizeof(rendering_params));
+    rendering_params.rendering_intent = gsPERCEPTUAL;
+    rendering_params.black_point_comp = gsBLACKPTCOMP_OFF;
+    rendering_params.preserve_black = gsBLACKPRESERVE_OFF;
+    link = gscms_get_link(devlink, NULL, &rendering_params,
+                          cmm_flags | GSCMS_FLAGS_STORED_LINK |
+                          cmsFLAGS_NOWHITEONWHITEFIXUP, memory);
+    cmsCloseProfile(ctx, devlink);
+    if (link != NULL)
+        gscms_image_clut_add(ctx, (gsicc_lcms2mt_link_list_t *)link,
+                             lcms_srchandle, lcms_deshandle, memory);
+    return link;
+}
+
 /* Do any initialization if needed to the CMS */
 void *
 gscms_create(gs_memory_t *memory)
@@ -895,6 +1424,8 @@ gscms_create(gs_memory_t *memory)
     cmsPlugin(ctx, cal_cms_extensions2());
 #endif
 
+    cmsPlugin(ctx, (void *)&gs_cms_stored_link_handler);
+
     cmsSetLogErrorHandler(ctx, gscms_error);
 
     return ctx;
@@ -921,6 +1452,7 @@ gscms_release_link(gsicc_link_t *icclink)
     while (link_handle != NULL) {
         gsicc_lcms2mt_link_list_t *next_handle;
         cmsDeleteTransform(ctx, link_handle->hTransform);
+        gscms_image_clut_free(link_handle->image_clut, icclink->memory);
         next_handle = link_handle->next;
         gs_free_object(icclink->memory->non_gc_memory, link_handle, "gscms_release_link");
         link_handle = next_handle;
@@ -1047,6 +1579,7 @@ gscms_get_name2device_link(gsicc_link_t *icclink,
     link_handle->flags = gsicc_link_flags(0, 0, 0, 0, 0,    /* no alpha, not planar, no endian swap */
                                           sizeof(gx_color_value), sizeof(gx_color_value));
     link_handle->hTransform = hTransformNew;
+    link_handle->image_clut = NULL;
     link_handle->next = NULL;
     icclink->link_handle = link_handle;
 
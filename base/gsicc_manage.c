@@ -129,6 +129,22 @@ gsicc_currentcoloraccuracy(gs_memory_t *mem)
     return ctx->icc_color_accuracy;
 }
 
+void
+gsicc_setimageclutdeltae(gs_memory_t *mem, float delta_e)
+{
+    gs_lib_ctx_t *ctx = gs_lib_ctx_get_interp_instance(mem);
+
+    ctx->icc_image_clut_delta_e = delta_e;
+}
+
+float
+gsicc_currentimageclutdeltae(gs_memory_t *mem)
+{
+    gs_lib_ctx_t *ctx = gs_lib_ctx_get_interp_instance(mem);
+
+    return ctx->icc_image_clut_delta_e;
+}
+
 /* Get the size of the ICC profile that is in the buffer */
 unsigned int
 gsicc_getprofilesize(unsigned char *buffer)
@@ -3090,6 +3106,37 @@ gs_seticcdirectory(const gs_gstate * pgs, gs_param_string * pval)
     return 0;
 }
 
+void
+gs_currenticclinkcachedirectory(const gs_gstate * pgs, gs_param_string * pval)
+{
+    static const char *const rfs = "";
+    const gs_lib_ctx_t *lib_ctx = pgs->memory->gs_lib_ctx;
+
+    if (lib_ctx->linkcachedir == NULL) {
+        pval->data = (const byte *)rfs;
+        pval->size = 0;
+        pval->persistent = true;
+    } else {
+        pval->data = (const byte *)(lib_ctx->linkcachedir);
+        pval->size = lib_ctx->linkcachedir_len;
+        pval->persistent = false;
+    }
+}
+
+int
+gs_seticclinkcachedirectory(const gs_gstate * pgs, gs_param_string * pval)
+{
+    int code = gs_lib_ctx_set_icc_link_cache_directory(pgs->memory,
+                                                       (const char *)pval->data,
+                                                       pval->size);
+
+    if (code == gs_error_invalidaccess)
+        return gs_rethrow(code, "cannot change the link cache directory under SAFER");
+    if (code < 0)
+        return gs_rethrow(gs_error_VMerror, "cannot allocate directory name");
+    return 0;
+}
+
 void
 gs_currentsrcgtagicc(const gs_gstate * pgs, gs_param_string * pval)
 {
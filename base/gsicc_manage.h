@@ -148,6 +148,8 @@ void gs_currentdefaultgrayicc(const gs_gstate * pgs, gs_param_string * pval);
 int gs_setdefaultgrayicc(const gs_gstate * pgs, gs_param_string * pval);
 void gs_currenticcdirectory(const gs_gstate * pgs, gs_param_string * pval);
 int gs_seticcdirectory(const gs_gstate * pgs, gs_param_string * pval);
+void gs_currenticclinkcachedirectory(const gs_gstate * pgs, gs_param_string * pval);
+int gs_seticclinkcachedirectory(const gs_gstate * pgs, gs_param_string * pval);
 void gs_currentsrcgtagicc(const gs_gstate * pgs, gs_param_string * pval);
 int gs_setsrcgtagicc(const gs_gstate * pgs, gs_param_string * pval);
 void gs_currentdefaultrgbicc(const gs_gstate * pgs, gs_param_string * pval);
@@ -161,6 +163,8 @@ int gs_setlabicc(const gs_gstate * pgs, gs_param_string * pval);
 int gsicc_get_device_class(cmm_profile_t *icc_profile);
 uint gsicc_currentcoloraccuracy(gs_memory_t *mem);
 void gsicc_setcoloraccuracy(gs_memory_t *mem, uint level);
+float gsicc_currentimageclutdeltae(gs_memory_t *mem);
+void gsicc_setimageclutdeltae(gs_memory_t *mem, float delta_e);
 
 #if ICC_DUMP
 static void dump_icc_buffer(const gs_memory_t *mem, int buffersize, char filename[],byte *Buffer);
@@ -109,6 +109,75 @@ gs_lib_ctx_set_icc_directory(const gs_memory_t *mem_gc, const char* pname,
     return 0;
 }
 
+/*  This sets the directory in which ICC links are kept between runs. An
+    empty name disables the persistent link cache. The directory is made
+    accessible when path control is activated, so it can't be changed
+    afterwards. */
+int
+gs_lib_ctx_set_icc_link_cache_directory(const gs_memory_t *mem_gc,
+                                        const char* pname, int dir_namelen)
+{
+    char *result = NULL;
+    gs_lib_ctx_t *p_ctx = mem_gc->gs_lib_ctx;
+    gs_memory_t *p_ctx_mem = p_ctx->memory;
+
+    if (p_ctx->linkcachedir != NULL && p_ctx->linkcachedir_len == dir_namelen &&
+        strncmp(pname, p_ctx->linkcachedir, dir_namelen) == 0)
+        return 0;
+    if (p_ctx->linkcachedir_len == 0 && dir_namelen == 0)
+        return 0;
+    if (gs_is_path_control_active(mem_gc))
+        return_error(gs_error_invalidaccess);
+    if (dir_namelen > 0) {
+        /* User param string.  Must allocate in non-gc memory */
+        result = (char*) gs_alloc_bytes(p_ctx_mem, dir_namelen+1,
+                                        "gs_lib_ctx_set_icc_link_cache_directory");
+        if (result == NULL)
+            return gs_error_VMerror;
+        memcpy(result, pname, dir_namelen);
+        result[dir_namelen] = 0;
+    }
+    gs_free_object(p_ctx_mem, p_ctx->linkcachedir,
+                   "gs_lib_ctx_set_icc_link_cache_directory");
+    p_ctx->linkcachedir = result;
+    p_ctx->linkcachedir_len = (result == NULL ? 0 : dir_namelen);
+    return 0;
+}
+
+/*  This sets the directory in which rendered FAPI glyphs are kept between
+    runs. An empty name disables the persistent glyph cache. As with the
+    link cache directory, it can't be changed once path control is active. */
+int
+gs_lib_ctx_set_glyph_cache_directory(const gs_memory_t *mem_gc,
+                                     const char* pname, int dir_namelen)
+{
+    char *result = NULL;
+    gs_lib_ctx_t *p_ctx = mem_gc->gs_lib_ctx;
+    gs_memory_t *p_ctx_mem = p_ctx->memory;
+
+    if (p_ctx->glyphcachedir != NULL && p_ctx->glyphcachedir_len == dir_namelen &&
+        strncmp(pname, p_ctx->glyphcachedir, dir_namelen) == 0)
+        return 0;
+    if (p_ctx->glyphcachedir_len == 0 && dir_namelen == 0)
+        return 0;
+    if (gs_is_path_control_active(mem_gc))
+        return_error(gs_error_invalidaccess);
+    if (dir_namelen > 0) {
+        /* User param string.  Must allocate in non-gc memory */
+        result = (char*) gs_alloc_bytes(p_ctx_mem, dir_namelen+1,
+                                        "gs_lib_ctx_set_glyph_cache_directory");
+        if (result == NULL)
+            return gs_error_VMerror;
+        memcpy(result, pname, dir_namelen);
+        result[dir_namelen] = 0;
+    }
+    gs_free_object(p_ctx_mem, p_ctx->glyphcachedir,
+                   "gs_lib_ctx_set_glyph_cache_directory");
+    p_ctx->glyphcachedir = result;
+    p_ctx->glyphcachedir_len = (result == NULL ? 0 : dir_namelen);
+    return 0;
+}
+
 /* Sets/Gets the string containing the list of default devices we should try */
 int
 gs_lib_ctx_set_default_device_list(const gs_memory_t *mem, const char* dev_list_str,
@@ -363,7 +432,12 @@ core_create_failed:
     /* Initialize our default ICCProfilesDir */
     pio->profiledir = NULL;
     pio->profiledir_len = 0;
+    pio->linkcachedir = NULL;
+    pio->linkcachedir_len = 0;
+    pio->glyphcachedir = NULL;
+    pio->glyphcachedir_len = 0;
     pio->icc_color_accuracy = MAX_COLOR_ACCURACY;
+    pio->icc_image_clut_delta_e = 0;
     if (gs_lib_ctx_set_icc_directory(mem, DEFAULT_DIR_ICC, strlen(DEFAULT_DIR_ICC)) < 0)
       goto Failure;
 
@@ -424,6 +498,10 @@ void gs_lib_ctx_fin(gs_memory_t *mem)
     sjpxd_destroy(mem);
     gs_free_object(ctx_mem, ctx->profiledir,
         "gs_lib_ctx_fin");
+    gs_free_object(ctx_mem, ctx->linkcachedir,
+        "gs_lib_ctx_fin");
+    gs_free_object(ctx_mem, ctx->glyphcachedir,
+        "gs_lib_ctx_fin");
 
     gs_free_object(ctx_mem, ctx->default_device_list,
                 "gs_lib_ctx_fin");
@@ -494,6 +572,22 @@ int gs_lib_ctx_get_act_on_uel( const gs_memory_t *mem )
     return mem->gs_lib_ctx->core->act_on_uel;
 }
 
+/* True if the job being run has a deadline, and has passed it. */
+int gs_lib_ctx_job_expired( const gs_memory_t *mem )
+{
+    gs_lib_ctx_core_t *core;
+    long now[2];
+
+    if (mem == NULL)
+        return 0;
+    core = mem->gs_lib_ctx->core;
+    if (core->job_deadline[0] == 0 && core->job_deadline[1] == 0)
+        return 0;
+    gp_get_realtime(now);
+    return now[0] > core->job_deadline[0] ||
+           (now[0] == core->job_deadline[0] && now[1] >= core->job_deadline[1]);
+}
+
 /* Provide a single point for all "C" stdout and stderr.
  */
 
@@ -128,6 +128,10 @@ typedef struct {
     int CPSI_mode;
     int scanconverter;
     int act_on_uel;
+    /* When the job being run should stop, as from gp_get_realtime, or
+     * {0, 0} if there is no limit. Set by gpdl's job server; the
+     * interpreters check it at their interrupt points. */
+    long job_deadline[2];
 
     int path_control_active;
     gs_path_control_set_t permit_reading;
@@ -182,6 +186,8 @@ typedef struct gs_lib_ctx_s
     uint screen_min_screen_levels;
     /* Accuracy vs. performance for ICC color */
     uint icc_color_accuracy;
+    /* Largest delta E allowed for the image CLUT fast path, 0 disables it */
+    float icc_image_clut_delta_e;
     /* real time clock 'bias' value. Not strictly required, but some FTS
      * tests work better if realtime starts from 0 at boot time. */
     long real_time_0[2];
@@ -194,6 +200,10 @@ typedef struct gs_lib_ctx_s
      * and one in the device */
     char *profiledir;               /* Directory used in searching for ICC profiles */
     int profiledir_len;             /* length of directory name (allows for Unicode) */
+    char *linkcachedir;             /* Directory for persistent ICC links, NULL if none */
+    int linkcachedir_len;
+    char *glyphcachedir;            /* Directory for persistent FAPI glyphs, NULL if none */
+    int glyphcachedir_len;
     gs_fapi_server **fapi_servers;
     char *default_device_list;
     int gcsignal;
@@ -224,6 +234,7 @@ gs_lib_ctx_t *gs_lib_ctx_get_interp_instance( const gs_memory_t *mem );
 
 void *gs_lib_ctx_get_cms_context( const gs_memory_t *mem );
 int gs_lib_ctx_get_act_on_uel( const gs_memory_t *mem );
+int gs_lib_ctx_job_expired( const gs_memory_t *mem );
 
 int gs_lib_ctx_register_callout(gs_memory_t *mem, gs_callout_fn, void *arg);
 void gs_lib_ctx_deregister_callout(gs_memory_t *mem, gs_callout_fn, void *arg);
@@ -234,6 +245,12 @@ int gs_lib_ctx_nts_adjust(gs_memory_t *mem, int adjust);
 int gs_lib_ctx_set_icc_directory(const gs_memory_t *mem_gc, const char* pname,
                                  int dir_namelen);
 
+int gs_lib_ctx_set_icc_link_cache_directory(const gs_memory_t *mem_gc,
+                                            const char* pname, int dir_namelen);
+
+int gs_lib_ctx_set_glyph_cache_directory(const gs_memory_t *mem_gc,
+                                         const char* pname, int dir_namelen);
+
 
 /* Sets/Gets the string containing the list of device names we should search
  * to find a suitable default
@@ -1716,6 +1716,7 @@ gx_pattern_cache_lookup(gx_device_color * pdevc, const gs_gstate * pgs,
             int px = pgs->screen_phase[select].x;
             int py = pgs->screen_phase[select].y;
 
+            ctile->lru_stamp = ++pcache->clock;
             if (gx_dc_is_pattern1_color(pdevc)) {       /* colored */
                 pdevc->colors.pattern.p_tile = ctile;
 #           if 0 /* Debugged with Bug688308.ps and applying patterns after clist.
@@ -2321,7 +2322,7 @@ gx_dc_pattern_read(
 
         /* If the pattern tile is already in the cache, make sure it isn't locked */
         /* The lock will be reset below, but the read logic needs to finish loading the pattern. */
-        ptile = &(pgs->pattern_cache->tiles[buf.id % pgs->pattern_cache->num_tiles]);
+        ptile = gx_pattern_cache_find_tile_for_id(pgs->pattern_cache, buf.id);
         if (ptile->id != gs_no_id && ptile->is_locked) {
             /* we shouldn't have miltiple tiles locked, but check if OK before unlocking */
             if (ptile->id != buf.id)
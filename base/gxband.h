@@ -41,6 +41,8 @@ typedef struct gx_colors_usage_s {
                                 /* executed plane-by-plane on CMYK devices */
     gs_int_rect trans_bbox;	/* transparency bbox allows skipping the pdf14 compositor for some bands */
                                 /* coordinates are band relative, 0 <= p.y < page_info.band_params.BandHeight */
+    int64_t cmd_bytes;		/* size of the band's command list, an estimate */
+    uint cmd_ops;		/* of the cost of rendering the band */
 } gx_color_usage_t;
 
 /*
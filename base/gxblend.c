@@ -29,6 +29,9 @@
 #ifdef WITH_CAL
 #include "cal.h"
 #endif
+#ifdef HAVE_SSE2
+#include <emmintrin.h>
+#endif
 
 typedef int art_s32;
 
@@ -46,6 +49,9 @@ static int track_compose_groups = 0;
 static void dump_track_compose_groups(void);
 #endif
 
+/* Define this to time the SSE2 group compositions against the scalar ones */
+#undef BENCH_COMPOSE_GROUPS
+
 
 /* For spot colors, blend modes must be white preserving and separable.  The
  * order of the blend modes should be reordered so this is a single compare */
@@ -3299,6 +3305,367 @@ compose_group_alphaless_nonknockout(byte *tos_ptr, bool tos_isolated, int tos_pl
         backdrop_ptr, /* has_matte */ false , n_chan, additive, num_spots, overprint, drawn_comps, x0, y0, x1, y1, pblend_procs, pdev, 0);
 }
 
+#ifdef HAVE_SSE2
+/* SSE2 versions of the commonest non-knockout compositions. They work on
+ * 8 (or 16) pixels of each plane at a time and give exactly the results
+ * of template_compose_group for the cases they are chosen for: no soft
+ * mask, shape, tags, alpha_g or spots, and a separable blend mode that
+ * doesn't need a table or a divide. Columns left over at the right hand
+ * edge are passed on to the scalar function. */
+
+/* (a * b + 0x80 + ((a * b + 0x80) >> 8)) >> 8 on 16 bit lanes */
+static forceinline __m128i
+sse2_mul_8(__m128i a, __m128i b)
+{
+    __m128i t = _mm_add_epi16(_mm_mullo_epi16(a, b), _mm_set1_epi16(0x80));
+
+    return _mm_srli_epi16(_mm_add_epi16(t, _mm_srli_epi16(t, 8)), 8);
+}
+
+/* The hard light blend, with the test made on 'test' (the backdrop for overlay) */
+static forceinline __m128i
+sse2_hard_light_8(__m128i b, __m128i s, __m128i test)
+{
+    __m128i ff = _mm_set1_epi16(0xff);
+    __m128i lo = _mm_slli_epi16(_mm_mullo_epi16(b, s), 1);
+    __m128i hi = _mm_sub_epi16(_mm_set1_epi16(0xfe01),
+                       _mm_slli_epi16(_mm_mullo_epi16(_mm_sub_epi16(ff, b),
+                                                      _mm_sub_epi16(ff, s)), 1));
+    __m128i is_lo = _mm_cmplt_epi16(test, _mm_set1_epi16(0x80));
+    __m128i t = _mm_or_si128(_mm_and_si128(is_lo, lo), _mm_andnot_si128(is_lo, hi));
+
+    t = _mm_add_epi16(t, _mm_set1_epi16(0x80));
+    return _mm_srli_epi16(_mm_add_epi16(t, _mm_srli_epi16(t, 8)), 8);
+}
+
+/* Separable blend modes done here, matching art_blend_pixel_8_inline */
+static bool
+sse2_blend_mode_ok(gs_blend_mode_t blend_mode)
+{
+    switch (blend_mode) {
+        case BLEND_MODE_Normal:
+        case BLEND_MODE_Multiply:
+        case BLEND_MODE_Screen:
+        case BLEND_MODE_Overlay:
+        case BLEND_MODE_HardLight:
+        case BLEND_MODE_Darken:
+        case BLEND_MODE_Lighten:
+        case BLEND_MODE_Difference:
+        case BLEND_MODE_Exclusion:
+            return true;
+        default:
+            return false;
+    }
+}
+
+static forceinline __m128i
+sse2_blend_8(__m128i b, __m128i s, gs_blend_mode_t blend_mode)
+{
+    __m128i ff = _mm_set1_epi16(0xff);
+    __m128i t;
+
+    switch (blend_mode) {
+        case BLEND_MODE_Multiply:
+            return sse2_mul_8(b, s);
+        case BLEND_MODE_Screen:
+            return _mm_sub_epi16(ff, sse2_mul_8(_mm_sub_epi16(ff, b), _mm_sub_epi16(ff, s)));
+        case BLEND_MODE_Overlay:
+            return sse2_hard_light_8(b, s, b);
+        case BLEND_MODE_HardLight:
+            return sse2_hard_light_8(b, s, s);
+        case BLEND_MODE_Darken:
+            return _mm_min_epi16(b, s);
+        case BLEND_MODE_Lighten:
+            return _mm_max_epi16(b, s);
+        case BLEND_MODE_Difference:
+            return _mm_sub_epi16(_mm_max_epi16(b, s), _mm_min_epi16(b, s));
+        case BLEND_MODE_Exclusion:
+            t = _mm_add_epi16(_mm_mullo_epi16(_mm_sub_epi16(ff, b), s),
+                              _mm_mullo_epi16(b, _mm_sub_epi16(ff, s)));
+            t = _mm_add_epi16(t, _mm_set1_epi16(0x80));
+            return _mm_srli_epi16(_mm_add_epi16(t, _mm_srli_epi16(t, 8)), 8);
+        default:
+            return s;
+    }
+}
+
+/* An isolated group over a non-knockout backdrop (art_pdf_composite_group_8
+ * followed by art_pdf_composite_pixel_alpha_8_inline) for width a multiple of 8. */
+static forceinline void
+template_compose_group_isolated_sse2(byte *gs_restrict tos_ptr, int tos_planestride, int tos_rowstride,
+                                     byte *gs_restrict nos_ptr, int nos_planestride, int nos_rowstride,
+                                     byte alpha, gs_blend_mode_t blend_mode, int n_chan,
+                                     bool additive, int width, int height)
+{
+    __m128i zero = _mm_setzero_si128();
+    __m128i ff = _mm_set1_epi16(0xff);
+    __m128i c80 = _mm_set1_epi16(0x80);
+    __m128i one = _mm_set1_epi16(1);
+    __m128i round = _mm_set1_epi32(0x8000);
+    __m128i alpha_v = _mm_set1_epi16(alpha);
+    __m128i comp = additive ? zero : _mm_set1_epi8((char)0xff);
+    uint16_t a_s[8], a_r[8], scale_lo[8], scale_hi[8];
+    int x, y, i, k;
+
+    for (y = height; y > 0; --y) {
+        for (x = 0; x < width; x += 8) {
+            byte *gs_restrict tos = tos_ptr + x;
+            byte *gs_restrict nos = nos_ptr + x;
+            __m128i src_alpha, dst_alpha, res_alpha, s_lo, s_hi, ab_lo, ab_hi;
+
+            src_alpha = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i *)(tos + n_chan * tos_planestride)), zero);
+            if (alpha != 255)
+                src_alpha = sse2_mul_8(src_alpha, alpha_v);
+            if (_mm_movemask_epi8(_mm_cmpeq_epi16(src_alpha, zero)) == 0xffff)
+                continue;	/* nothing to composite */
+            dst_alpha = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i *)(nos + n_chan * nos_planestride)), zero);
+            /* Result alpha is Union of backdrop and source alpha */
+            res_alpha = _mm_sub_epi16(ff, sse2_mul_8(_mm_sub_epi16(ff, dst_alpha), _mm_sub_epi16(ff, src_alpha)));
+
+            /* a_s / a_r in 16.16 format. Where a_s is 0 this leaves the pixel
+               unchanged, as a_r is then a_b. The scale is split in two 7 bit
+               halves so that _mm_madd_epi16 can apply it. */
+            _mm_storeu_si128((__m128i *)a_s, src_alpha);
+            _mm_storeu_si128((__m128i *)a_r, res_alpha);
+            for (k = 0; k < 8; k++) {
+                int src_scale = a_r[k] == 0 ? 0 : ((a_s[k] << 16) + (a_r[k] >> 1)) / a_r[k];
+
+                scale_lo[k] = src_scale & 0x7f;
+                scale_hi[k] = src_scale >> 7;
+            }
+            s_lo = _mm_loadu_si128((const __m128i *)scale_lo);
+            s_hi = _mm_loadu_si128((const __m128i *)scale_hi);
+            s_hi = _mm_unpackhi_epi16(s_lo, s_hi);
+            s_lo = _mm_unpacklo_epi16(s_lo, _mm_loadu_si128((const __m128i *)scale_hi));
+            ab_lo = _mm_unpacklo_epi16(dst_alpha, c80);
+            ab_hi = _mm_unpackhi_epi16(dst_alpha, c80);
+
+            for (i = 0; i < n_chan; i++) {
+                __m128i c_b = _mm_unpacklo_epi8(_mm_xor_si128(_mm_loadl_epi64((const __m128i *)(nos + i * nos_planestride)), comp), zero);
+                __m128i c_s = _mm_unpacklo_epi8(_mm_xor_si128(_mm_loadl_epi64((const __m128i *)(tos + i * tos_planestride)), comp), zero);
+                __m128i c_mix = c_s;
+                __m128i d, lo, hi;
+
+                if (blend_mode != BLEND_MODE_Normal) {
+                    /* c_mix = c_s + a_b * (c_bl - c_s) / 255 */
+                    d = _mm_sub_epi16(sse2_blend_8(c_b, c_s, blend_mode), c_s);
+                    lo = _mm_madd_epi16(ab_lo, _mm_unpacklo_epi16(d, one));
+                    hi = _mm_madd_epi16(ab_hi, _mm_unpackhi_epi16(d, one));
+                    lo = _mm_srai_epi32(_mm_add_epi32(lo, _mm_srai_epi32(lo, 8)), 8);
+                    hi = _mm_srai_epi32(_mm_add_epi32(hi, _mm_srai_epi32(hi, 8)), 8);
+                    c_mix = _mm_add_epi16(c_s, _mm_packs_epi32(lo, hi));
+                }
+                /* c_b + (src_scale * (c_mix - c_b) + 0x8000) >> 16 */
+                d = _mm_sub_epi16(c_mix, c_b);
+                lo = _mm_madd_epi16(s_lo, _mm_unpacklo_epi16(d, _mm_slli_epi16(d, 7)));
+                hi = _mm_madd_epi16(s_hi, _mm_unpackhi_epi16(d, _mm_slli_epi16(d, 7)));
+                lo = _mm_srai_epi32(_mm_add_epi32(lo, round), 16);
+                hi = _mm_srai_epi32(_mm_add_epi32(hi, round), 16);
+                d = _mm_add_epi16(c_b, _mm_packs_epi32(lo, hi));
+                _mm_storel_epi64((__m128i *)(nos + i * nos_planestride),
+                                 _mm_xor_si128(_mm_packus_epi16(d, d), comp));
+            }
+            _mm_storel_epi64((__m128i *)(nos + n_chan * nos_planestride), _mm_packus_epi16(res_alpha, res_alpha));
+        }
+        tos_ptr += tos_rowstride;
+        nos_ptr += nos_rowstride;
+    }
+}
+
+static void
+compose_group_nonknockout_nonblend_isolated_nomask_sse2(byte *tos_ptr, bool tos_isolated, int tos_planestride, int tos_rowstride, byte alpha, byte shape, gs_blend_mode_t blend_mode, bool tos_has_shape,
+              int tos_shape_offset, int tos_alpha_g_offset, int tos_tag_offset, bool tos_has_tag, byte *tos_alpha_g_ptr,
+              byte *nos_ptr, bool nos_isolated, int nos_planestride, int nos_rowstride, byte *nos_alpha_g_ptr, bool nos_knockout,
+              int nos_shape_offset, int nos_tag_offset,
+              byte *mask_row_ptr, int has_mask, pdf14_buf *maskbuf, byte mask_bg_alpha, const byte *mask_tr_fn,
+              byte *backdrop_ptr,
+              bool has_matte, int n_chan, bool additive, int num_spots, bool overprint, gx_color_index drawn_comps, int x0, int y0, int x1, int y1,
+              const pdf14_nonseparable_blending_procs_t *pblend_procs, pdf14_device *pdev)
+{
+    int width = (x1 - x0) & ~7;
+
+    /* As for the scalar version, additive or not makes no difference here */
+    template_compose_group_isolated_sse2(tos_ptr, tos_planestride, tos_rowstride,
+        nos_ptr, nos_planestride, nos_rowstride, alpha, BLEND_MODE_Normal, n_chan,
+        /*additive*/1, width, y1 - y0);
+    if (x0 + width < x1)
+        compose_group_nonknockout_nonblend_isolated_nomask_common(tos_ptr + width, tos_isolated, tos_planestride, tos_rowstride,
+            alpha, shape, blend_mode, tos_has_shape, tos_shape_offset, tos_alpha_g_offset, tos_tag_offset, tos_has_tag,
+            tos_alpha_g_ptr, nos_ptr + width, nos_isolated, nos_planestride, nos_rowstride, nos_alpha_g_ptr, nos_knockout,
+            nos_shape_offset, nos_tag_offset, mask_row_ptr, has_mask, maskbuf, mask_bg_alpha, mask_tr_fn,
+            backdrop_ptr, has_matte, n_chan, additive, num_spots, overprint, drawn_comps, x0 + width, y0, x1, y1, pblend_procs, pdev);
+}
+
+static void
+compose_group_nonknockout_blend_isolated_nomask_sse2(byte *tos_ptr, bool tos_isolated, int tos_planestride, int tos_rowstride, byte alpha, byte shape, gs_blend_mode_t blend_mode, bool tos_has_shape,
+              int tos_shape_offset, int tos_alpha_g_offset, int tos_tag_offset, bool tos_has_tag, byte *tos_alpha_g_ptr,
+              byte *nos_ptr, bool nos_isolated, int nos_planestride, int nos_rowstride, byte *nos_alpha_g_ptr, bool nos_knockout,
+              int nos_shape_offset, int nos_tag_offset,
+              byte *mask_row_ptr, int has_mask, pdf14_buf *maskbuf, byte mask_bg_alpha, const byte *mask_tr_fn,
+              byte *backdrop_ptr,
+              bool has_matte, int n_chan, bool additive, int num_spots, bool overprint, gx_color_index drawn_comps, int x0, int y0, int x1, int y1,
+              const pdf14_nonseparable_blending_procs_t *pblend_procs, pdf14_device *pdev)
+{
+    int width = (x1 - x0) & ~7;
+
+    template_compose_group_isolated_sse2(tos_ptr, tos_planestride, tos_rowstride,
+        nos_ptr, nos_planestride, nos_rowstride, alpha, blend_mode, n_chan,
+        additive, width, y1 - y0);
+    if (x0 + width < x1)
+        compose_group_nonknockout_blend(tos_ptr + width, tos_isolated, tos_planestride, tos_rowstride,
+            alpha, shape, blend_mode, tos_has_shape, tos_shape_offset, tos_alpha_g_offset, tos_tag_offset, tos_has_tag,
+            tos_alpha_g_ptr, nos_ptr + width, nos_isolated, nos_planestride, nos_rowstride, nos_alpha_g_ptr, nos_knockout,
+            nos_shape_offset, nos_tag_offset, mask_row_ptr, has_mask, maskbuf, mask_bg_alpha, mask_tr_fn,
+            backdrop_ptr, has_matte, n_chan, additive, num_spots, overprint, drawn_comps, x0 + width, y0, x1, y1, pblend_procs, pdev);
+}
+
+/* A non-isolated group with no mask and full alpha in normal blend mode:
+ * uncompositing and recompositing cancel out (art_pdf_recomposite_group_8)
+ * so every pixel the group painted (alpha_g != 0) is simply copied. */
+static void
+compose_group_nonknockout_nonblend_nonisolated_nomask_sse2(byte *tos_ptr, bool tos_isolated, int tos_planestride, int tos_rowstride, byte alpha, byte shape, gs_blend_mode_t blend_mode, bool tos_has_shape,
+              int tos_shape_offset, int tos_alpha_g_offset, int tos_tag_offset, bool tos_has_tag, byte *tos_alpha_g_ptr,
+              byte *nos_ptr, bool nos_isolated, int nos_planestride, int nos_rowstride, byte *nos_alpha_g_ptr, bool nos_knockout,
+              int nos_shape_offset, int nos_tag_offset,
+              byte *mask_row_ptr, int has_mask, pdf14_buf *maskbuf, byte mask_bg_alpha, const byte *mask_tr_fn,
+              byte *backdrop_ptr,
+              bool has_matte, int n_chan, bool additive, int num_spots, bool overprint, gx_color_index drawn_comps, int x0, int y0, int x1, int y1,
+              const pdf14_nonseparable_blending_procs_t *pblend_procs, pdf14_device *pdev)
+{
+    int width = (x1 - x0) & ~15;
+    __m128i zero = _mm_setzero_si128();
+    byte *gs_restrict tos_row = tos_ptr;
+    byte *gs_restrict nos_row = nos_ptr;
+    int x, y, i;
+
+    for (y = y1 - y0; y > 0; --y) {
+        for (x = 0; x < width; x += 16) {
+            __m128i keep = _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i *)(tos_row + x + tos_alpha_g_offset)), zero);
+
+            if (_mm_movemask_epi8(keep) == 0xffff)
+                continue;
+            for (i = 0; i <= n_chan; i++) {
+                __m128i *nos = (__m128i *)(nos_row + x + i * nos_planestride);
+                __m128i tos = _mm_loadu_si128((const __m128i *)(tos_row + x + i * tos_planestride));
+
+                _mm_storeu_si128(nos, _mm_or_si128(_mm_and_si128(keep, _mm_loadu_si128(nos)),
+                                                   _mm_andnot_si128(keep, tos)));
+            }
+        }
+        tos_row += tos_rowstride;
+        nos_row += nos_rowstride;
+    }
+    if (x0 + width < x1)
+        compose_group_nonknockout_nonblend_nonisolated_nomask_common(tos_ptr + width, tos_isolated, tos_planestride, tos_rowstride,
+            alpha, shape, blend_mode, tos_has_shape, tos_shape_offset, tos_alpha_g_offset, tos_tag_offset, tos_has_tag,
+            tos_alpha_g_ptr, nos_ptr + width, nos_isolated, nos_planestride, nos_rowstride, nos_alpha_g_ptr, nos_knockout,
+            nos_shape_offset, nos_tag_offset, mask_row_ptr, has_mask, maskbuf, mask_bg_alpha, mask_tr_fn,
+            backdrop_ptr, has_matte, n_chan, additive, num_spots, overprint, drawn_comps, x0 + width, y0, x1, y1, pblend_procs, pdev);
+}
+#ifdef BENCH_COMPOSE_GROUPS
+/* Time the SSE2 compositions against the scalar ones on synthetic planar
+ * buffers, and check that both give the same results. This runs once, the
+ * first time a group is composed, in builds with BENCH_COMPOSE_GROUPS. */
+static long
+bench_compose_time(art_pdf_compose_group_fn fn, byte *tos, byte *nos, const byte *nos_init,
+                   int n_chan, int width, int height, bool tos_isolated, byte alpha,
+                   gs_blend_mode_t blend_mode, bool additive, int reps, pdf14_device *pdev)
+{
+    int planestride = width * height;
+    int alpha_g_offset = (n_chan + 1) * planestride;
+    long t0[2], t1[2];
+    int i;
+
+    gp_get_realtime(t0);
+    for (i = 0; i < reps; i++) {
+        memcpy(nos, nos_init, planestride * (n_chan + 2));
+        fn(tos, tos_isolated, planestride, width, alpha, 255, blend_mode, false,
+           alpha_g_offset, alpha_g_offset, 0, false, NULL,
+           nos, false, planestride, width, NULL, false, 0, 0,
+           NULL, 0, NULL, 0, NULL, NULL, false, n_chan, additive, 0, false, 0,
+           0, 0, width, height, pdev->blend_procs, pdev);
+    }
+    gp_get_realtime(t1);
+    return (t1[0] - t0[0]) * 1000000 + (t1[1] - t0[1]) / 1000;
+}
+
+static void
+bench_compose_groups(gs_memory_t *mem, pdf14_device *pdev)
+{
+    static const struct {
+        const char *name;
+        art_pdf_compose_group_fn scalar, sse2;
+        bool tos_isolated;
+        byte alpha;
+        gs_blend_mode_t blend_mode;
+        bool additive;
+    } tests[] = {
+        { "Normal isolated", compose_group_nonknockout_nonblend_isolated_nomask_common,
+          compose_group_nonknockout_nonblend_isolated_nomask_sse2, true, 255, BLEND_MODE_Normal, true },
+        { "Normal isolated alpha", compose_group_nonknockout_nonblend_isolated_nomask_common,
+          compose_group_nonknockout_nonblend_isolated_nomask_sse2, true, 160, BLEND_MODE_Normal, true },
+        { "Normal non-isolated", compose_group_nonknockout_nonblend_nonisolated_nomask_common,
+          compose_group_nonknockout_nonblend_nonisolated_nomask_sse2, false, 255, BLEND_MODE_Normal, true },
+        { "Multiply", compose_group_nonknockout_blend, compose_group_nonknockout_blend_isolated_nomask_sse2,
+          true, 200, BLEND_MODE_Multiply, true },
+        { "Multiply subtractive", compose_group_nonknockout_blend, compose_group_nonknockout_blend_isolated_nomask_sse2,
+          true, 200, BLEND_MODE_Multiply, false },
+        { "Screen", compose_group_nonknockout_blend, compose_group_nonknockout_blend_isolated_nomask_sse2,
+          true, 255, BLEND_MODE_Screen, true },
+        { "Overlay", compose_group_nonknockout_blend, compose_group_nonknockout_blend_isolated_nomask_sse2,
+          true, 255, BLEND_MODE_Overlay, true },
+        { "HardLight", compose_group_nonknockout_blend, compose_group_nonknockout_blend_isolated_nomask_sse2,
+          true, 255, BLEND_MODE_HardLight, true },
+        { "Darken", compose_group_nonknockout_blend, compose_group_nonknockout_blend_isolated_nomask_sse2,
+          true, 255, BLEND_MODE_Darken, true },
+        { "Lighten", compose_group_nonknockout_blend, compose_group_nonknockout_blend_isolated_nomask_sse2,
+          true, 255, BLEND_MODE_Lighten, true },
+        { "Difference", compose_group_nonknockout_blend, compose_group_nonknockout_blend_isolated_nomask_sse2,
+          true, 255, BLEND_MODE_Difference, true },
+        { "Exclusion", compose_group_nonknockout_blend, compose_group_nonknockout_blend_isolated_nomask_sse2,
+          true, 255, BLEND_MODE_Exclusion, true }
+    };
+    const int n_chan = 4, width = 1027, height = 64, reps = 200;
+    int size = width * height * (n_chan + 2);
+    byte *tos = gs_alloc_bytes(mem, size, "bench_compose_groups");
+    byte *nos_init = gs_alloc_bytes(mem, size, "bench_compose_groups");
+    byte *nos_a = gs_alloc_bytes(mem, size, "bench_compose_groups");
+    byte *nos_b = gs_alloc_bytes(mem, size, "bench_compose_groups");
+    uint seed = 1;
+    int i;
+
+    if (tos == NULL || nos_init == NULL || nos_a == NULL || nos_b == NULL)
+        goto done;
+    for (i = 0; i < size; i++) {
+        byte v;
+
+        seed = seed * 1103515245 + 12345;
+        v = seed >> 16;
+        /* Make plenty of the alpha and alpha_g values 0 or 255 */
+        if (i >= width * height * n_chan && (v & 3) < 2)
+            v = (v & 3) ? 0xff : 0;
+        tos[i] = v;
+        nos_init[i] = (byte)(v * 7 + (i >> 3));
+    }
+    for (i = 0; i < countof(tests); i++) {
+        long t_scalar = bench_compose_time(tests[i].scalar, tos, nos_a, nos_init, n_chan, width, height,
+                            tests[i].tos_isolated, tests[i].alpha, tests[i].blend_mode, tests[i].additive, reps, pdev);
+        long t_sse2 = bench_compose_time(tests[i].sse2, tos, nos_b, nos_init, n_chan, width, height,
+                            tests[i].tos_isolated, tests[i].alpha, tests[i].blend_mode, tests[i].additive, reps, pdev);
+
+        dmprintf5(mem, "compose %-22s scalar %8ldus  sse2 %8ldus  x%.2f  %s\n", tests[i].name,
+                  t_scalar, t_sse2, t_sse2 > 0 ? (double)t_scalar / t_sse2 : 0.0,
+                  memcmp(nos_a, nos_b, size) ? "MISMATCH" : "ok");
+    }
+done:
+    gs_free_object(mem, tos, "bench_compose_groups");
+    gs_free_object(mem, nos_init, "bench_compose_groups");
+    gs_free_object(mem, nos_a, "bench_compose_groups");
+    gs_free_object(mem, nos_b, "bench_compose_groups");
+}
+#endif
+#endif /* HAVE_SSE2 */
+
 static void
 do_compose_group(pdf14_buf *tos, pdf14_buf *nos, pdf14_buf *maskbuf,
               int x0, int x1, int y0, int y1, int n_chan, bool additive,
@@ -3443,11 +3810,28 @@ do_compose_group(pdf14_buf *tos, pdf14_buf *nos, pdf14_buf *maskbuf,
 
     /* We have tested the files on the cluster to see what percentage of
      * files/devices hit the different options. */
+#if defined(BENCH_COMPOSE_GROUPS) && defined(HAVE_SSE2)
+    {
+        static int bench_compose = 0;
+
+        if (bench_compose == 0) {
+            bench_compose = 1;
+            bench_compose_groups(memory->non_gc_memory, pdev);
+        }
+    }
+#endif
+
     if (nos_knockout)
         fn = &compose_group_knockout; /* Small %ages, nothing more than 1.1% */
-    else if (blend_mode != 0)
+    else if (blend_mode != 0) {
         fn = &compose_group_nonknockout_blend; /* Small %ages, nothing more than 2% */
-    else if (tos->has_shape == 0 && tos_has_tag == 0 && nos_isolated == 0 && nos_alpha_g_ptr == NULL &&
+#ifdef HAVE_SSE2
+        if (tos_isolated && maskbuf == NULL && tos->has_shape == 0 && tos_has_tag == 0 &&
+            nos_alpha_g_ptr == NULL && nos_shape_offset == 0 && nos_tag_offset == 0 &&
+            num_spots == 0 && !overprint && sse2_blend_mode_ok(blend_mode))
+            fn = &compose_group_nonknockout_blend_isolated_nomask_sse2;
+#endif
+    } else if (tos->has_shape == 0 && tos_has_tag == 0 && nos_isolated == 0 && nos_alpha_g_ptr == NULL &&
              nos_shape_offset == 0 && nos_tag_offset == 0 && backdrop_ptr == NULL && has_matte == 0 && num_spots == 0 &&
              overprint == 0 && tos_alpha_g_ptr == NULL) {
              /* Additive vs Subtractive makes no difference in normal blend mode with no spots */
@@ -3476,11 +3860,20 @@ do_compose_group(pdf14_buf *tos, pdf14_buf *nos, pdf14_buf *maskbuf,
                     /* Outside mask */
                     fn = &compose_group_nonknockout_nonblend_isolated_mask_common;
                 } else
+#ifdef HAVE_SSE2
+                    fn = &compose_group_nonknockout_nonblend_isolated_nomask_sse2;
+#else
                     fn = &compose_group_nonknockout_nonblend_isolated_nomask_common;
+#endif
         } else {
             if (has_mask || maskbuf) /* 4% */
                 fn = &compose_group_nonknockout_nonblend_nonisolated_mask_common;
             else /* 15% */
+#ifdef HAVE_SSE2
+                if (alpha == 255)
+                    fn = &compose_group_nonknockout_nonblend_nonisolated_nomask_sse2;
+                else
+#endif
                 fn = &compose_group_nonknockout_nonblend_nonisolated_nomask_common;
         }
     } else
@@ -405,10 +405,11 @@ struct gx_clist_state_s {
          { 0, 0 }, { {0, 0}, {0, 0}}, { gx_no_color_index, gx_no_color_index },\
         { {NULL}, {NULL} },\
          { 0, 0, 0, 0 }, lop_default, 0, 0, 0, 0, initial_known,\
-        { 0, 0 }, /* cmd_list */\
+        { 0, 0, 0, 0 }, /* cmd_list */\
         { 0, /* or */\
           0, /* slow rop */\
-          { { max_int, max_int }, /* p */ { min_int, min_int } /* q */ } /* trans_bbox */\
+          { { max_int, max_int }, /* p */ { min_int, min_int } /* q */ }, /* trans_bbox */\
+          0, 0 /* cmd_bytes, cmd_ops */\
         } /* color_usage */
 
 /* Define the size of the command buffer used for reading. */
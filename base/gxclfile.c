@@ -229,8 +229,20 @@ typedef struct
     int64_t pos;
     int64_t filesize;		/* filesize maintained by clist_fwrite */
     CL_CACHE *cache;
+    const byte *map;		/* read-only mapping of the file, see clist_fmap */
+    int64_t map_size;
 } IFILE;
 
+static void
+clist_unmap_file(IFILE *ifile)
+{
+    if (ifile->map != NULL) {
+        gp_funmap(ifile->map, (size_t)ifile->map_size);
+        ifile->map = NULL;
+        ifile->map_size = 0;
+    }
+}
+
 static void
 file_to_fake_path(clist_file_ptr file, char fname[gp_file_name_sizeof])
 {
@@ -262,6 +274,8 @@ static IFILE *wrap_file(gs_memory_t *mem, gp_file *f, const char *fmode)
     ifile->pos = 0;
     ifile->filesize = 0;
     ifile->cache = cl_cache_alloc(ifile->mem);
+    ifile->map = NULL;
+    ifile->map_size = 0;
     return ifile;
 }
 
@@ -269,6 +283,7 @@ static int clist_close_file(IFILE *ifile)
 {
     int res = 0;
     if (ifile) {
+        clist_unmap_file(ifile);
         if (ifile->f != NULL)
             res = gp_fclose(ifile->f);
         if (ifile->cache != NULL)
@@ -373,6 +388,8 @@ clist_fwrite_chars(const void *data, uint len, clist_file_ptr cf)
         cl_cache_destroy(icf->cache);
         icf->cache = NULL;
     }
+    /* and so does any mapping */
+    clist_unmap_file(icf);
     return res;
 }
 
@@ -484,6 +501,7 @@ clist_rewind(clist_file_ptr cf, bool discard_data, const char *fname)
              * new scratch file. */
             char tfname[gp_file_name_sizeof] = {0};
             const gs_memory_t *mem = ocf->f->memory;
+            clist_unmap_file(ocf);
             gp_fclose(ocf->f);
             ocf->f = gp_open_scratch_file_rm(mem, gp_scratch_file_name_prefix, tfname, fmode);
             if (ocf->f == NULL)
@@ -508,6 +526,7 @@ clist_rewind(clist_file_ptr cf, bool discard_data, const char *fname)
              * get the same effect.
              */
 
+            clist_unmap_file((IFILE *)cf);
             /* Opening with "w" mode deletes the contents when closing. */
             f = gp_freopen(fname, gp_fmode_wb, f);
             if (f == NULL) return_error(gs_error_ioerror);
@@ -552,6 +571,42 @@ clist_fseek(clist_file_ptr cf, int64_t offset, int mode, const char *ignore_fnam
     return res;
 }
 
+/* ------ Mapping ------ */
+
+/* Once a page has been written, the band readers (one per rendering thread,
+ * each with its own clone of the files) map the files rather than reading
+ * them through the slot cache above, so they take their data straight
+ * from the page cache, without a pread and a copy for each block. */
+static const byte *
+clist_fmap(clist_file_ptr cf, int64_t *psize)
+{
+    IFILE *ifile = (IFILE *)cf;
+    int64_t filesize = gp_can_share_fdesc() ? ifile->filesize : 0;
+
+    if (!gp_can_share_fdesc()) {
+        /* We don't track the size ourselves in this case. */
+        int64_t pos = gp_ftell(ifile->f);
+
+        if (pos < 0 || gp_fseek(ifile->f, 0, SEEK_END) != 0)
+            return NULL;
+        filesize = gp_ftell(ifile->f);
+        if (gp_fseek(ifile->f, pos, SEEK_SET) != 0)
+            return NULL;
+    }
+    if (ifile->map != NULL && ifile->map_size != filesize)
+        clist_unmap_file(ifile);
+    if (ifile->map == NULL) {
+        if (filesize <= 0 || filesize != (int64_t)(size_t)filesize)
+            return NULL;
+        ifile->map = gp_fmap(ifile->f, (size_t)filesize);
+        if (ifile->map == NULL)
+            return NULL;
+        ifile->map_size = filesize;
+    }
+    *psize = ifile->map_size;
+    return ifile->map;
+}
+
 static clist_io_procs_t clist_io_procs_file = {
     clist_fopen,
     clist_fclose,
@@ -563,6 +618,7 @@ static clist_io_procs_t clist_io_procs_file = {
     clist_ftell,
     clist_rewind,
     clist_fseek,
+    clist_fmap,
 };
 
 init_proc(gs_gxclfile_init);
@@ -88,6 +88,17 @@ struct clist_io_procs_s {
     int (*rewind)(clist_file_ptr cf, bool discard_data, const char *fname);
 
     int (*fseek)(clist_file_ptr cf, int64_t offset, int mode, const char *fname);
+
+    /* ---------------- Mapping ---------------- */
+
+    /*
+     * Return a read-only view of the whole file as written so far, and
+     * its size in *psize, or NULL if the implementation can't provide one
+     * (in which case the caller must use fread_chars). The view stays valid
+     * until the file is next written to, rewound with discard_data, or
+     * closed, and reading through it doesn't move the file position.
+     */
+    const byte *(*fmap)(clist_file_ptr cf, int64_t *psize);
 };
 
 typedef struct clist_io_procs_s clist_io_procs_t;
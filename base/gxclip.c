@@ -159,6 +159,13 @@ gx_destroy_clip_device_on_stack(gx_device_clip * dev)
         ((gx_clip_path *)dev->cpath)->cached = (dev->current == &dev->list.single ? NULL : dev->current); /* Cast away const */
 }
 
+/* Check whether a device is a clipper. */
+bool
+gx_device_is_clip(const gx_device *dev)
+{
+    return dev_proc(dev, open_device) == clip_open;
+}
+
 gx_device *
 gx_make_clip_device_on_stack_if_needed(gx_device_clip * dev, const gx_clip_path *pcpath, gx_device *target, gs_fixed_rect *rect)
 {
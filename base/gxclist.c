@@ -434,7 +434,7 @@ clist_init_data(gx_device * dev, byte * init_data, size_t data_size)
             /* The top of the tile_cache is the bottom of the imagable band buffer,
              * which needs to be appropriately aligned. Because the band height is
              * fixed, we must round *down* the size of the cache to a appropriate
-             * value. See clist_render_thread() and clist_rasterize_lines()
+             * value. See clist_render_band() and clist_rasterize_lines()
              * for where the value is used.
              */
             bits_size = ROUND_DOWN(bits_size, align);
@@ -449,7 +449,7 @@ clist_init_data(gx_device * dev, byte * init_data, size_t data_size)
             /* The top of the tile_cache is the bottom of the imagable band buffer,
              * which needs to be appropriately aligned. Because the band height is
              * fixed, here we round up the size of the cache, since the band height
-             * is variable, and it should only be a few bytes. See clist_render_thread()
+             * is variable, and it should only be a few bytes. See clist_render_band()
              * and clist_rasterize_lines() for where the value is used.
              */
             bits_size = ROUND_UP(bits_size, align);
@@ -1172,6 +1172,8 @@ clist_write_color_usage_array(gx_device_clist_writer *cldev)
         return gs_rethrow(-1, "insufficient memory for color_usage_array");
     for (i = 0; i < cldev->nbands; i++) {
         memcpy(&(color_usage_array[i]), &(cldev->states[i].color_usage), sizeof(gx_color_usage_t));
+        color_usage_array[i].cmd_bytes = cldev->states[i].list.cmd_bytes;
+        color_usage_array[i].cmd_ops = cldev->states[i].list.cmd_ops;
     }
     /* Now go ahead and save the table data */
     cmd_write_pseudo_band(cldev, (unsigned char *)color_usage_array,
@@ -155,6 +155,8 @@ struct cmd_prefix_s {
 /* There is one of these for each band, plus one for band-range commands. */
 typedef struct cmd_list_s {
     cmd_prefix *head, *tail;	/* list of commands for band */
+    int64_t cmd_bytes;		/* total size of the commands added this page */
+    uint cmd_ops;		/* number of commands added this page */
 } cmd_list;
 
 /*
@@ -383,6 +385,7 @@ struct gx_device_clist_writer_s {
 #define clist_disable_copy_alpha (1 << 6) /* target does not support copy_alpha */
 
 typedef struct clist_render_thread_control_s clist_render_thread_control_t;
+typedef struct clist_render_sched_s clist_render_sched_t;
 
 /* Define the state of a band list when reading. */
 /* For normal rasterizing, pages and num_pages are both 0. */
@@ -394,8 +397,9 @@ typedef struct gx_device_clist_reader_s {
     gx_color_usage_t *color_usage_array; /* per band color_usage */
     int num_pages;
     void *offset_map; /* Just against collecting the map as garbage. */
-    int num_render_threads;		/* number of threads being used */
+    int num_render_threads;		/* number of threads (or band slots) being used */
     clist_render_thread_control_t *render_threads;	/* array of threads */
+    clist_render_sched_t *render_sched;	/* band scheduler, NULL unless in-order output */
     byte *main_thread_data;		/* saved data pointer of main thread */
     int curr_render_thread;		/* index into array */
     int thread_lookahead_direction;	/* +1 or -1 */
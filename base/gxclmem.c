@@ -1260,6 +1260,7 @@ clist_io_procs_t clist_io_procs_memory = {
     memfile_ftell,
     memfile_rewind,
     memfile_fseek,
+    NULL,			/* fmap: the data may be compressed */
 };
 
 init_proc(gs_gxclmem_init);
@@ -71,6 +71,11 @@ typedef struct stream_band_read_state_s {
     uint left;			/* amount of data left in this run */
     cmd_block b_this;
     gs_memory_t *local_memory;
+    /* If the files can be mapped, we read them directly from the mappings,
+     * keeping our own positions, rather than using fread_chars. */
+    const byte *cmap, *bmap;
+    int64_t cmap_size, bmap_size;
+    int64_t cpos, bpos;
 #ifdef DEBUG
     bool skip_first;
     cbuf_offset_map_elem *offset_map;
@@ -91,6 +96,15 @@ s_band_read_init(stream_state * st)
     ss->b_this.band_min = 0;
     ss->b_this.band_max = 0;
     ss->b_this.pos = 0;
+    ss->cmap = ss->bmap = NULL;
+    ss->cpos = ss->bpos = 0;
+    if (io_procs->fmap != NULL) {
+        ss->cmap = io_procs->fmap(ss->page_info.cfile, &ss->cmap_size);
+        if (ss->cmap != NULL)
+            ss->bmap = io_procs->fmap(ss->page_info.bfile, &ss->bmap_size);
+        if (ss->bmap == NULL || ss->bmap_size < ss->page_info.bfile_end_pos)
+            ss->cmap = ss->bmap = NULL;
+    }
     return io_procs->rewind(ss->page_info.bfile, false, ss->page_info.bfname);
 }
 
@@ -182,7 +196,15 @@ s_band_read_process(stream_state * st, stream_cursor_read * ignore_pr,
                 }
             }
 #endif
-            io_procs->fread_chars(q + 1, count, cfile);
+            if (ss->cmap != NULL) {
+                if (ss->cpos + count > ss->cmap_size) {
+                    status = ERRC;
+                    break;
+                }
+                memcpy(q + 1, ss->cmap + ss->cpos, count);
+                ss->cpos += count;
+            } else
+                io_procs->fread_chars(q + 1, count, cfile);
             if (io_procs->ferror_code(cfile) < 0) {
                 status = ERRC;
                 break;
@@ -199,7 +221,8 @@ s_band_read_process(stream_state * st, stream_cursor_read * ignore_pr,
             /* If we hit eof, end! */
             /* Could this test be moved into the nread < sizeof() test below? */
             if (ss->b_this.band_min == cmd_band_end &&
-                io_procs->ftell(bfile) == ss->page_info.bfile_end_pos) {
+                (ss->bmap != NULL ? ss->bpos : io_procs->ftell(bfile)) ==
+                    ss->page_info.bfile_end_pos) {
                 pw->ptr = q;
                 ss->left = left;
                 return EOFC;
@@ -213,14 +236,22 @@ s_band_read_process(stream_state * st, stream_cursor_read * ignore_pr,
             bmin = ss->b_this.band_min;
             bmax = ss->b_this.band_max;
             pos = ss->b_this.pos; /* Record where our data starts! */
-            nread = io_procs->fread_chars(&ss->b_this, sizeof(ss->b_this), bfile);
+            if (ss->bmap != NULL) {
+                nread = (int)min((int64_t)sizeof(ss->b_this), ss->bmap_size - ss->bpos);
+                memcpy(&ss->b_this, ss->bmap + ss->bpos, nread);
+                ss->bpos += nread;
+            } else
+                nread = io_procs->fread_chars(&ss->b_this, sizeof(ss->b_this), bfile);
             if (nread < sizeof(ss->b_this)) {
                 DISCARD(gs_note_error(gs_error_unregistered)); /* Must not happen. */
                 return ERRC;
             }
         } while (ss->band_last < bmin || ss->band_first > bmax);
         /* So let's set up to read the actual command data from cfile. Seek... */
-        io_procs->fseek(cfile, pos, SEEK_SET, ss->page_info.cfname);
+        if (ss->cmap != NULL)
+            ss->cpos = pos;
+        else
+            io_procs->fseek(cfile, pos, SEEK_SET, ss->page_info.cfname);
         left = (uint) (ss->b_this.pos - pos);
 #ifdef DEBUG
         if (left > 0  && gs_debug_c('L')) {
@@ -236,7 +267,8 @@ s_band_read_process(stream_state * st, stream_cursor_read * ignore_pr,
         if_debug5m('l', ss->local_memory,
                    "[l]reading for bands (%d,%d) at bfile %"PRId64", cfile %"PRId64", length %u\n",
                    bmin, bmax,
-                   (io_procs->ftell(bfile) - sizeof(ss->b_this)), (int64_t)pos, left);
+                   ((ss->bmap != NULL ? ss->bpos : io_procs->ftell(bfile)) -
+                    sizeof(ss->b_this)), (int64_t)pos, left);
     }
     pw->ptr = q;
     ss->left = left;
@@ -705,6 +737,7 @@ clist_render_init(gx_device_clist *dev)
     crdev->icc_table = NULL;
     crdev->color_usage_array = NULL;
     crdev->render_threads = NULL;
+    crdev->render_sched = NULL;
 
     return 0;
 }
@@ -27,6 +27,7 @@
 #include "gdevprn.h"            /* must precede gxcldev.h */
 #include "gxcldev.h"
 #include "gxgetbit.h"
+#include "gxdevsop.h"
 #include "gdevplnx.h"
 #include "gdevppla.h"
 #include "gsmemory.h"
@@ -40,8 +41,11 @@
 
 /* Forward reference prototypes */
 static int clist_start_render_thread(gx_device *dev, int thread_index, int band);
-static void clist_render_thread(void* param);
+static void clist_render_worker(void* param);
 static void clist_render_thread_no_output_fn(void* param);
+static int clist_start_render_workers(gx_device *dev, int y, int direction, int num_workers);
+static void clist_stop_render_workers(gx_device *dev);
+static void clist_free_render_sched(gx_device *dev);
 
 /*
         Notes on operation:
@@ -83,13 +87,27 @@ static void clist_render_thread_no_output_fn(void* param);
         order those renderings finish in, we can only ever output them
         in the order 0,1,2,3.
 
-        This means that if band 3 finishes early (perhaps its contents
-        are less complex than the other bands), it will be sat there
-        idle waiting for all the other bands to finish before it can
-        output, and resume its next rendering.
+        If every thread were tied to the band it rendered, then if band
+        3 finished early (perhaps its contents are less complex than the
+        other bands), it would be sat there idle waiting for all the
+        other bands to finish before it could output, and resume its
+        next rendering.
+
+        To stop one slow band (perhaps a large transparency group)
+        from leaving the other threads idle, the rendering of a band
+        is decoupled from the thread doing it. Each entry of
+        render_threads[] is a band 'slot' (a device copy with its own
+        band buffer), and there are CLIST_RENDER_SLOTS_PER_THREAD
+        times as many slots as threads. The worker threads take the
+        next unrendered band (in output order) as soon as a slot is
+        free, regardless of which thread rendered which band before,
+        so with 4 workers and 8 slots, bands 4..7 can be rendered
+        while band 0 is still in progress. The slots form a bounded
+        reorder buffer: the main thread waits for each band in order,
+        calls output_fn, and releases the slot for reuse.
 
         For devices that are not dependent on the order in which data
-        becomes available, we therefore offer a second mechanism; by
+        becomes available, we also offer a second mechanism; by
         setting output_fn to NULL, we indicate that process_fn will
         not only render the page, it will 'output' it too, and handle
         the selection of which band to render next.
@@ -383,6 +401,8 @@ clist_setup_render_threads(gx_device *dev, int y, gx_process_page_options_t *opt
     int reserve_size = 2 * 1024 * 1024 + (gx_ht_cache_default_bits_size() * dev->color_info.num_components);
     clist_icctable_entry_t *curr_entry;
     bool deep = device_is_deep(dev);
+    bool in_order = (options == NULL || options->output_fn != NULL);
+    int first_band, num_workers;
 
     crdev->num_render_threads = pdev->num_render_threads_requested;
 
@@ -406,6 +426,14 @@ clist_setup_render_threads(gx_device *dev, int y, gx_process_page_options_t *opt
     /* don't exceed our limit (allow for BGPrint and main thread) */
     if (crdev->num_render_threads > MAX_THREADS - 2)
         crdev->num_render_threads = MAX_THREADS - 2;
+    num_workers = crdev->num_render_threads;
+    /* For in-order output, give each worker more than one band slot so */
+    /* that rendering can continue past a band that is slow to finish.  */
+    if (in_order) {
+        crdev->num_render_threads *= CLIST_RENDER_SLOTS_PER_THREAD;
+        if (crdev->num_render_threads > band_count)
+            crdev->num_render_threads = band_count;
+    }
 
     /* Allocate and initialize an array of thread control structures */
     crdev->render_threads = (clist_render_thread_control_t *)
@@ -435,7 +463,7 @@ clist_setup_render_threads(gx_device *dev, int y, gx_process_page_options_t *opt
     /* Based on the line number requested, decide the order of band rendering */
     /* Almost all devices go in increasing line order (except the bmp* devices ) */
     crdev->thread_lookahead_direction = (y < (cdev->height - 1)) ? 1 : -1;
-    band = y / band_height;
+    band = first_band = y / band_height;
 
     /* If the 'mem' is not thread safe, we need to wrap it in a locking memory */
     gs_memory_status(chunk_base_mem, &mem_status);
@@ -516,7 +544,8 @@ clist_setup_render_threads(gx_device *dev, int y, gx_process_page_options_t *opt
         }
         /* We don't start the threads yet until we  free up the */
         /* reserve memory we have allocated for that band. */
-        thread->band = band;
+        /* In-order slots get their bands from the workers.  */
+        thread->band = in_order ? -1 : band;
     }
     /* If the code < 0, the last thread creation failed -- clean it up */
     if (code < 0) {
@@ -581,16 +610,22 @@ clist_setup_render_threads(gx_device *dev, int y, gx_process_page_options_t *opt
      */
     for (j=0, code = 0; j<crdev->num_render_threads; j++) {
         gs_free_object(mem, reserve_memory_array[j], "clist_setup_render_threads");
-        if (code == 0 && j < i)
+        if (!in_order && code == 0 && j < i)
             code = clist_start_render_thread(dev, j, crdev->render_threads[j].band);
     }
     gs_free_object(mem, reserve_memory_array, "clist_setup_render_threads");
     crdev->num_render_threads = i;
     crdev->curr_render_thread = 0;
     crdev->next_band = band;
+    if (in_order) {
+        if (num_workers > i)
+            num_workers = i;
+        code = clist_start_render_workers(dev, y, crdev->thread_lookahead_direction, num_workers);
+    } else
+        num_workers = i;
 
     if(gs_debug[':'] != 0)
-        dmprintf1(mem, "%% Using %d rendering threads\n", i);
+        dmprintf2(mem, "%% Using %d rendering threads, %d band slots\n", num_workers, i);
 
     return code;
 }
@@ -668,6 +703,8 @@ clist_teardown_render_threads(gx_device *dev)
     int i;
 
     if (crdev->render_threads != NULL) {
+        /* Stop the in-order workers, if any, leaving every slot idle */
+        clist_free_render_sched(dev);
         /* Wait for all threads to finish */
         for (i = (crdev->num_render_threads - 1); i >= 0; i--) {
             clist_render_thread_control_t *thread = &(crdev->render_threads[i]);
@@ -725,37 +762,27 @@ clist_teardown_render_threads(gx_device *dev)
     }
 }
 
+/* Start a thread for the output_fn == NULL mechanism. The in-order */
+/* mechanism uses clist_start_render_workers instead.                */
 static int
 clist_start_render_thread(gx_device *dev, int thread_index, int band)
 {
     gx_device_clist *cldev = (gx_device_clist *)dev;
     gx_device_clist_reader *crdev = &cldev->reader;
     int code;
-    gp_thread_creation_callback_t starter;
     gx_process_page_options_t* options = crdev->render_threads[thread_index].options;
 
     crdev->render_threads[thread_index].band = band;
 
-    /* Finally, fire it up */
-    if (options == NULL || options->output_fn) {
-        /* Traditional mechanism, using output_fn. Each thread will
-         * block after it renders until it has been output 'in-order'
-         * using output_fn. */
-        crdev->render_threads[thread_index].status = THREAD_BUSY;
+    /* process_fn is required to both render and output the data. Less
+     * blocking required, and potentially significant speedups as long as
+     * output does not need to be 'in-order'. */
+    /* This could pretty much be an assert. */
+    if (options == NULL || options->process_fn == NULL)
+        return_error(gs_error_rangecheck);
 
-        starter = clist_render_thread;
-    } else {
-        /* New mechanism, with output_fn == NULL. process_fn is
-         * required to both render and output the data. Less blocking
-         * required, and potentially significant speedups as long as
-         * output does not need to be 'in-order'. */
-        starter = clist_render_thread_no_output_fn;
-
-        /* This could pretty much be an assert. */
-        if (options == NULL || options->process_fn == NULL)
-            return_error(gs_error_rangecheck);
-    }
-    code = gp_thread_start(starter,
+    /* Finally, fire it up */
+    code = gp_thread_start(clist_render_thread_no_output_fn,
                            &(crdev->render_threads[thread_index]),
                            &(crdev->render_threads[thread_index].thread));
 
@@ -764,10 +791,10 @@ clist_start_render_thread(gx_device *dev, int thread_index, int band)
     return code;
 }
 
-static void
-clist_render_thread(void *data)
+/* Render the lines assigned to a slot into the slot's band buffer */
+static int
+clist_render_band(clist_render_thread_control_t *thread)
 {
-    clist_render_thread_control_t *thread = (clist_render_thread_control_t *)data;
     gx_device *dev = thread->cdev;
     gx_device_clist *cldev = (gx_device_clist *)dev;
     gx_device_clist_reader *crdev = &cldev->reader;
@@ -777,19 +804,9 @@ clist_render_thread(void *data)
     byte *mlines = (crdev->page_info.line_ptrs_offset == 0 ? NULL : mdata + crdev->page_info.line_ptrs_offset);
     uint raster = gx_device_raster_plane(dev, NULL);
     int code;
-    int band_height = crdev->page_info.band_params.BandHeight;
-    int band = thread->band;
-    int band_begin_line = band * band_height;
-    int band_end_line = band_begin_line + band_height;
-    int band_num_lines;
-#ifdef DEBUG
-    long starttime[2], endtime[2];
-
-    gp_get_usertime(starttime); /* thread start time */
-#endif
-    if (band_end_line > dev->height)
-        band_end_line = dev->height;
-    band_num_lines = band_end_line - band_begin_line;
+    int band_begin_line = thread->band_begin_line;
+    int band_end_line = thread->band_end_line;
+    int band_num_lines = band_end_line - band_begin_line;
 
     code = crdev->buf_procs.setup_buf_device
             (bdev, mdata, raster, (byte **)mlines, 0, band_num_lines, band_num_lines);
@@ -807,23 +824,284 @@ clist_render_thread(void *data)
     crdev->ymin = band_begin_line;
     crdev->ymax = band_end_line;
     crdev->offset_map = NULL;
-    if (code < 0)
-        thread->status = THREAD_ERROR;          /* shouldn't happen */
-    else
-        thread->status = THREAD_DONE;    /* OK */
+    return code;
+}
 
+/*
+ * Worker thread for in-order output. Each worker repeatedly claims the next
+ * unit in delivery order (whichever worker is free first gets it) and
+ * renders it into slot (seq % num_render_threads), then signals that slot.
+ * A unit can only be claimed once the unit previously using its slot has
+ * been delivered; until then the worker adds itself to the idle list and
+ * waits to be woken by clist_get_band_from_thread.
+ */
+static void
+clist_render_worker(void *data)
+{
+    clist_render_worker_t *worker = (clist_render_worker_t *)data;
+    gx_device_clist_reader *crdev = worker->crdev;
+    clist_render_sched_t *sched = crdev->render_sched;
+    clist_render_thread_control_t *thread;
+    int seq, unit, code;
+    long starttime[2], endtime[2];
+
+    for (;;) {
+        gx_monitor_enter(sched->lock);
+        while (!sched->abort && sched->next_seq < sched->num_seq &&
+               sched->next_seq >= sched->deliver_seq + crdev->num_render_threads) {
+            sched->idle[sched->num_idle++] = worker - sched->workers;
+            gx_monitor_leave(sched->lock);
+            gx_semaphore_wait(worker->wake);
+            gx_monitor_enter(sched->lock);
+        }
+        if (sched->abort || sched->next_seq >= sched->num_seq) {
+            gx_monitor_leave(sched->lock);
+            break;
+        }
+        seq = sched->next_seq++;
+        gx_monitor_leave(sched->lock);
+
+        thread = &(crdev->render_threads[seq % crdev->num_render_threads]);
+        unit = sched->first_unit + seq * sched->direction;
+        thread->band_begin_line = sched->unit_y[unit];
+        thread->band_end_line = sched->unit_y[unit + 1];
+        thread->band = thread->band_begin_line / crdev->page_info.band_params.BandHeight;
+        thread->status = THREAD_BUSY;
+        gp_get_realtime(starttime);
 #ifdef DEBUG
-    gp_get_usertime(endtime);
-    thread->cputime += (endtime[0] - starttime[0]) * 1000 +
-             (endtime[1] - starttime[1]) / 1000000;
+        {
+            long ustart[2], uend[2];
+
+            gp_get_usertime(ustart);
+            code = clist_render_band(thread);
+            gp_get_usertime(uend);
+            thread->cputime += (uend[0] - ustart[0]) * 1000 +
+                     (uend[1] - ustart[1]) / 1000000;
+        }
+#else
+        code = clist_render_band(thread);
 #endif
-    /*
-     * Signal the semaphores. We signal the 'group' first since even if
-     * the waiter is released on the group, it still needs to check
-     * status on the thread
-     */
-    gx_semaphore_signal(thread->sema_group);
-    gx_semaphore_signal(thread->sema_this);
+        gp_get_realtime(endtime);
+        if (sched->band_time != NULL)
+            sched->band_time[unit] = (endtime[0] - starttime[0]) * 1000000 +
+                     (endtime[1] - starttime[1]) / 1000;
+        if (code < 0)
+            thread->status = THREAD_ERROR;          /* shouldn't happen */
+        else
+            thread->status = THREAD_DONE;    /* OK */
+        gx_semaphore_signal(thread->sema_this);
+    }
+}
+
+/* Estimate the cost of rendering a band from its recorded command list. */
+/* Each command costs a little beyond its size for the dispatch.         */
+static int64_t
+clist_band_cost(const gx_color_usage_t *color_usage)
+{
+    return color_usage->cmd_bytes + 16 * (int64_t)color_usage->cmd_ops;
+}
+
+/* Divide the page into render units for the in-order workers: one per */
+/* band, unless AdaptiveBanding splits the bands that cost the most.   */
+static int
+clist_plan_render_units(gx_device *dev, clist_render_sched_t *sched)
+{
+    gx_device_printer *pdev = (gx_device_printer *)dev;
+    gx_device_clist *cldev = (gx_device_clist *)dev;
+    gx_device_clist_common *cdev = (gx_device_clist_common *)dev;
+    gx_device_clist_reader *crdev = &cldev->reader;
+    gs_memory_t *mem = cdev->bandlist_memory;
+    int band_height = crdev->page_info.band_params.BandHeight;
+    int band_count = cdev->nbands;
+    int max_units = band_count;
+    int64_t total_cost = 0, mean_cost = 0;
+    int i, y, n = 0, used_bands = 0;
+
+    if (pdev->adaptive_banding_requested && crdev->color_usage_array != NULL) {
+        for (i = 0; i < band_count; i++) {
+            int64_t cost = clist_band_cost(&crdev->color_usage_array[i]);
+
+            if (cost > 0) {
+                total_cost += cost;
+                used_bands++;
+            }
+        }
+        if (used_bands > 0) {
+            mean_cost = total_cost / used_bands;
+            max_units = band_count * CLIST_BAND_SPLIT_MAX;
+        }
+    }
+    sched->unit_y = (int *)gs_alloc_byte_array(mem, max_units + 1, sizeof(int),
+                                               "clist_plan_render_units");
+    if (sched->unit_y == NULL)
+        return_error(gs_error_VMerror);
+    for (i = 0; i < band_count; i++) {
+        int band_begin_line = i * band_height;
+        int band_end_line = min(band_begin_line + band_height, dev->height);
+        int step = band_end_line - band_begin_line;
+        int64_t cost = mean_cost > 0 ? clist_band_cost(&crdev->color_usage_array[i]) : 0;
+
+        if (mean_cost > 0 && cost > mean_cost * CLIST_BAND_SPLIT_RATIO) {
+            int pieces = (int)min(cost / mean_cost, CLIST_BAND_SPLIT_MAX);
+            int adjusted;
+
+            /* The sub-bands must still suit the device (downscaling, etc.) */
+            step = (step + pieces - 1) / pieces;
+            adjusted = dev_proc(dev, dev_spec_op)(dev, gxdso_adjust_bandheight, NULL, step);
+            if (adjusted == 0)
+                step = band_end_line - band_begin_line;
+            else if (adjusted > 0)
+                step = adjusted;
+        }
+        for (y = band_begin_line; y < band_end_line; y += step)
+            sched->unit_y[n++] = y;
+    }
+    sched->unit_y[n] = dev->height;
+    sched->num_units = n;
+    if (gs_debug[':'] != 0 && n > band_count)
+        dmprintf2(mem, "%% AdaptiveBanding: %d bands rendered as %d units\n", band_count, n);
+    return 0;
+}
+
+/* Find the render unit containing line y */
+static int
+clist_render_unit_of_line(const clist_render_sched_t *sched, int y)
+{
+    int lo = 0, hi = sched->num_units - 1;
+
+    while (lo < hi) {
+        int mid = (lo + hi + 1) >> 1;
+
+        if (sched->unit_y[mid] <= y)
+            lo = mid;
+        else
+            hi = mid - 1;
+    }
+    return lo;
+}
+
+/* Set up the scheduler and start the in-order workers. The units from */
+/* the one containing line y onwards in 'direction' are rendered,      */
+/* using all the slots.                                                */
+static int
+clist_start_render_workers(gx_device *dev, int y, int direction, int num_workers)
+{
+    gx_device_clist *cldev = (gx_device_clist *)dev;
+    gx_device_clist_common *cdev = (gx_device_clist_common *)dev;
+    gx_device_clist_reader *crdev = &cldev->reader;
+    gs_memory_t *mem = cdev->bandlist_memory;
+    clist_render_sched_t *sched = crdev->render_sched;
+    int i, first_unit, code = 0;
+
+    if (sched == NULL) {
+        sched = (clist_render_sched_t *)gs_alloc_bytes(mem, sizeof(clist_render_sched_t),
+                                                        "clist_start_render_workers");
+        if (sched == NULL)
+            return_error(gs_error_VMerror);
+        memset(sched, 0, sizeof(clist_render_sched_t));
+        crdev->render_sched = sched;
+        code = clist_plan_render_units(dev, sched);
+        if (code < 0)
+            return code;
+        /* The timings are only a diagnostic, so carry on without them */
+        sched->band_time = (long *)gs_alloc_byte_array(mem, sched->num_units, sizeof(long),
+                                                       "clist_start_render_workers");
+        if (sched->band_time != NULL)
+            memset(sched->band_time, 0, sched->num_units * sizeof(long));
+        sched->lock = gx_monitor_label(gx_monitor_alloc(mem), "BandSched");
+        if (sched->lock == NULL)
+            return_error(gs_error_VMerror);
+        for (i = 0; i < num_workers; i++) {
+            sched->workers[i].crdev = crdev;
+            sched->workers[i].wake = gx_semaphore_label(gx_semaphore_alloc(mem), "BandWake");
+            if (sched->workers[i].wake == NULL)
+                return_error(gs_error_VMerror);
+        }
+    }
+    first_unit = clist_render_unit_of_line(sched, y);
+    sched->first_unit = first_unit;
+    sched->direction = direction;
+    sched->num_seq = direction > 0 ? sched->num_units - first_unit : first_unit + 1;
+    sched->next_seq = 0;
+    sched->deliver_seq = 0;
+    sched->num_idle = 0;
+    sched->abort = false;
+    for (i = 0; i < crdev->num_render_threads; i++) {
+        crdev->render_threads[i].band = -1;
+        crdev->render_threads[i].status = THREAD_IDLE;
+    }
+    for (i = 0; i < num_workers && sched->workers[i].wake != NULL; i++) {
+        code = gp_thread_start(clist_render_worker, &(sched->workers[i]), &(sched->workers[i].thread));
+        if (code < 0)
+            break;
+        gp_thread_label(sched->workers[i].thread, "Band");
+    }
+    sched->num_workers = i;
+    /* As long as one worker started, all the bands will get rendered */
+    return i > 0 ? 0 : code;
+}
+
+/* Stop the in-order workers, and wait for any bands they have claimed.   */
+/* Afterwards every slot is idle (any rendered data is discarded) and the */
+/* workers can be restarted with clist_start_render_workers.              */
+static void
+clist_stop_render_workers(gx_device *dev)
+{
+    gx_device_clist *cldev = (gx_device_clist *)dev;
+    gx_device_clist_reader *crdev = &cldev->reader;
+    clist_render_sched_t *sched = crdev->render_sched;
+    int i, seq;
+
+    if (sched == NULL || sched->num_workers == 0)
+        return;
+    gx_monitor_enter(sched->lock);
+    sched->abort = true;
+    while (sched->num_idle > 0)
+        gx_semaphore_signal(sched->workers[sched->idle[--sched->num_idle]].wake);
+    gx_monitor_leave(sched->lock);
+    for (i = 0; i < sched->num_workers; i++) {
+        gp_thread_finish(sched->workers[i].thread);
+        sched->workers[i].thread = NULL;
+    }
+    /* Consume the signals for bands rendered but never delivered */
+    for (seq = sched->deliver_seq; seq < sched->next_seq; seq++) {
+        clist_render_thread_control_t *thread =
+            &(crdev->render_threads[seq % crdev->num_render_threads]);
+
+        gx_semaphore_wait(thread->sema_this);
+        thread->status = THREAD_IDLE;
+        thread->band = -1;
+    }
+    sched->deliver_seq = sched->next_seq;
+}
+
+/* Free the in-order scheduler, reporting the band times if requested */
+static void
+clist_free_render_sched(gx_device *dev)
+{
+    gx_device_clist *cldev = (gx_device_clist *)dev;
+    gx_device_clist_common *cdev = (gx_device_clist_common *)dev;
+    gx_device_clist_reader *crdev = &cldev->reader;
+    gs_memory_t *mem = cdev->bandlist_memory;
+    clist_render_sched_t *sched = crdev->render_sched;
+    int i;
+
+    if (sched == NULL)
+        return;
+    clist_stop_render_workers(dev);
+    if (gs_debug[':'] != 0 && sched->band_time != NULL) {
+        for (i = 0; i < sched->num_units; i++)
+            dmprintf4(mem, "%% Band %d (lines %d-%d) render time %ld usec\n",
+                      sched->unit_y[i] / crdev->page_info.band_params.BandHeight,
+                      sched->unit_y[i], sched->unit_y[i + 1] - 1, sched->band_time[i]);
+    }
+    for (i = 0; i < MAX_THREADS; i++)
+        gx_semaphore_free(sched->workers[i].wake);
+    gx_monitor_free(sched->lock);
+    gs_free_object(mem, sched->band_time, "clist_free_render_sched");
+    gs_free_object(mem, sched->unit_y, "clist_free_render_sched");
+    gs_free_object(mem, sched, "clist_free_render_sched");
+    crdev->render_sched = NULL;
 }
 
 /* Used if output_fn == NULL. No blocking required as we no longer need to
@@ -912,74 +1190,73 @@ clist_render_thread_no_output_fn(void* data)
  * device (the main thread)
  * Return 0 if OK, < 0 is the error code from the thread
  *
- * After swapping the pointers, start up the completed thread with the
- * next band remaining to do (if any)
+ * After swapping the pointers, release the slot so that a worker can
+ * start on the next band remaining to do (if any)
  */
 static int
-clist_get_band_from_thread(gx_device *dev, int band_needed, gx_process_page_options_t *options)
+clist_get_band_from_thread(gx_device *dev, int y, gx_process_page_options_t *options)
 {
     gx_device_clist *cldev = (gx_device_clist *)dev;
     gx_device_clist_common *cdev = (gx_device_clist_common *)dev;
     gx_device_clist_reader *crdev = &cldev->reader;
-    int i, code = 0;
-    int thread_index = crdev->curr_render_thread;
-    clist_render_thread_control_t *thread = &(crdev->render_threads[thread_index]);
-    gx_device_clist_common *thread_cdev = (gx_device_clist_common *)thread->cdev;
-    int band_height = crdev->page_info.band_params.BandHeight;
-    int band_count = cdev->nbands;
+    clist_render_sched_t *sched = crdev->render_sched;
+    int code = 0;
+    int thread_index;
+    clist_render_thread_control_t *thread;
+    gx_device_clist_common *thread_cdev;
+    int unit_needed;
     byte *tmp;                  /* for swapping data areas */
 
-    /* We expect that the thread needed will be the 'current' thread */
-    if (thread->band != band_needed) {
-        int band = band_needed;
+    if (sched == NULL)
+        return_error(gs_error_unknownerror);
 
-        emprintf3(thread->memory,
-                  "thread->band = %d, band_needed = %d, direction = %d, ",
-                  thread->band, band_needed, crdev->thread_lookahead_direction);
+    /* We expect that the unit needed will be the next one in sequence */
+    unit_needed = clist_render_unit_of_line(sched, y);
+    if (sched->deliver_seq >= sched->num_seq ||
+        sched->first_unit + sched->deliver_seq * sched->direction != unit_needed) {
+        int num_workers = sched->num_workers;
 
-        /* Probably we went in the wrong direction, so let the threads */
-        /* all complete, then restart them in the opposite direction   */
+        emprintf3(dev->memory,
+                  "next band = %d, band_needed = %d, direction = %d, ",
+                  sched->first_unit + sched->deliver_seq * sched->direction,
+                  unit_needed, crdev->thread_lookahead_direction);
+
+        /* Probably we went in the wrong direction, so let the workers */
+        /* complete what they have, then restart them in the opposite  */
+        /* direction from the band needed.                             */
         /* If the caller is 'bouncing around' we may end up back here, */
         /* but that is a VERY rare case (we haven't seen it yet).      */
-        for (i=0; i < crdev->num_render_threads; i++) {
-            clist_render_thread_control_t *thread = &(crdev->render_threads[i]);
-
-            if (thread->status == THREAD_BUSY)
-                gx_semaphore_wait(thread->sema_this);
-        }
+        clist_stop_render_workers(dev);
         crdev->thread_lookahead_direction *= -1;      /* reverse direction (but may be overruled below) */
-        if (band_needed == band_count-1)
+        if (unit_needed == sched->num_units-1)
             crdev->thread_lookahead_direction = -1;   /* assume backwards if we are asking for the last band */
-        if (band_needed == 0)
+        if (unit_needed == 0)
             crdev->thread_lookahead_direction = 1;    /* force forward if we are looking for band 0 */
 
-        dmprintf1(thread->memory, "new_direction = %d\n", crdev->thread_lookahead_direction);
+        dmprintf1(dev->memory, "new_direction = %d\n", crdev->thread_lookahead_direction);
 
-        /* Loop starting the threads in the new lookahead_direction */
-        for (i=0; (i < crdev->num_render_threads) && (band >= 0) && (band < band_count);
-                i++, band += crdev->thread_lookahead_direction) {
-            thread = &(crdev->render_threads[i]);
-            thread->band = -1;          /* a value that won't match any valid band */
-            /* Start thread 'i' to do band */
-            if ((code = clist_start_render_thread(dev, i, band)) < 0)
-                break;
-        }
-        crdev->next_band = i;			/* may be < 0 or == band_count, but that is handled later */
-        crdev->curr_render_thread = thread_index = 0;
-        thread = &(crdev->render_threads[0]);
-        thread_cdev = (gx_device_clist_common *)thread->cdev;
+        code = clist_start_render_workers(dev, y, crdev->thread_lookahead_direction, num_workers);
+        if (code < 0)
+            return code;
     }
-    /* Wait for this thread */
+    thread_index = sched->deliver_seq % crdev->num_render_threads;
+    thread = &(crdev->render_threads[thread_index]);
+    thread_cdev = (gx_device_clist_common *)thread->cdev;
+
+    /* Wait for this slot */
     gx_semaphore_wait(thread->sema_this);
-    gp_thread_finish(thread->thread);
-    thread->thread = NULL;
     if (thread->status == THREAD_ERROR)
-        return_error(gs_error_unknownerror);          /* FAIL */
-
-    if (options && options->output_fn) {
+        code = gs_note_error(gs_error_unknownerror);          /* FAIL */
+    else if (options && options->output_fn)
         code = options->output_fn(options->arg, dev, thread->buffer);
-        if (code < 0)
-            return code;
+    if (code < 0) {
+        /* The slot is consumed, but not released, as the caller will */
+        /* tear down the threads.                                     */
+        thread->status = THREAD_IDLE;
+        gx_monitor_enter(sched->lock);
+        sched->deliver_seq++;
+        gx_monitor_leave(sched->lock);
+        return code;
     }
 
     /* Swap the data areas to avoid the copy */
@@ -989,18 +1266,16 @@ clist_get_band_from_thread(gx_device *dev, int band_needed, gx_process_page_opti
     thread->status = THREAD_IDLE;        /* the data is no longer valid */
     thread->band = -1;
     /* Update the bounds for this band */
-    cdev->ymin =  band_needed * band_height;
-    cdev->ymax =  cdev->ymin + band_height;
-    if (cdev->ymax > dev->height)
-        cdev->ymax = dev->height;
-
-    if (crdev->next_band >= 0 && crdev->next_band < band_count) {
-        code = clist_start_render_thread(dev, thread_index, crdev->next_band);
-        crdev->next_band += crdev->thread_lookahead_direction;
-    }
-    /* bump the 'curr' to the next thread */
-    crdev->curr_render_thread = crdev->curr_render_thread == crdev->num_render_threads - 1 ?
-                0 : crdev->curr_render_thread + 1;
+    cdev->ymin = sched->unit_y[unit_needed];
+    cdev->ymax = sched->unit_y[unit_needed + 1];
+
+    /* Let a worker use the slot for the next band remaining (if any) */
+    gx_monitor_enter(sched->lock);
+    sched->deliver_seq++;
+    if (sched->num_idle > 0)
+        gx_semaphore_signal(sched->workers[sched->idle[--sched->num_idle]].wake);
+    gx_monitor_leave(sched->lock);
+    crdev->curr_render_thread = sched->deliver_seq % crdev->num_render_threads;
 
     return code;
 }
@@ -1060,8 +1335,8 @@ clist_get_bits_rect_mt(gx_device *dev, const gs_int_rect * prect,
         }
     }
     /* If we already have the band's data, just return it */
-    if (y < crdev->ymin || end_y > crdev->ymax)
-        code = clist_get_band_from_thread(dev, band, NULL);
+    if (y < crdev->ymin || y >= crdev->ymax)
+        code = clist_get_band_from_thread(dev, y, NULL);
     if (code < 0)
         goto free_thread_out;
     mdata = crdev->data + crdev->page_info.tile_cache_size;
@@ -1072,7 +1347,7 @@ clist_get_bits_rect_mt(gx_device *dev, const gs_int_rect * prect,
                             y - crdev->ymin, line_count, crdev->ymax - crdev->ymin)) < 0)
         goto free_thread_out;
 
-    lines_rasterized = min(band_height, line_count);
+    lines_rasterized = min(crdev->ymax - y, line_count);
     /* Return as much of the rectangle as falls within the rasterized lines. */
     band_rect = *prect;
     band_rect.p.y = 0;
@@ -1213,9 +1488,7 @@ clist_process_page_mt(gx_device *dev, gx_process_page_options_t *options)
     gx_device_printer *pdev = (gx_device_printer *)dev;
     gx_device_clist *cldev = (gx_device_clist *)dev;
     gx_device_clist_reader *crdev = &cldev->reader;
-    int band_height = crdev->page_info.band_params.BandHeight;
-    int band;
-    int num_bands = (dev->height + band_height-1)/band_height;
+    int y;
     int code;
     int reverse = !!(options->options & GX_PROCPAGE_BOTTOM_UP);
 
@@ -1239,18 +1512,18 @@ clist_process_page_mt(gx_device *dev, gx_process_page_options_t *options)
          * rendering until it is their turn to call output_fn. */
         if (reverse)
         {
-            for (band = num_bands - 1; band > 0; band--)
+            for (y = dev->height - 1; y >= 0; y = crdev->ymin - 1)
             {
-                code = clist_get_band_from_thread(dev, band, options);
+                code = clist_get_band_from_thread(dev, y, options);
                 if (code < 0)
                     goto free_thread_out;
             }
         }
         else
         {
-            for (band = 0; band < num_bands; band++)
+            for (y = 0; y < dev->height; y = crdev->ymax)
             {
-                code = clist_get_band_from_thread(dev, band, options);
+                code = clist_get_band_from_thread(dev, y, options);
                 if (code < 0)
                     goto free_thread_out;
             }
@@ -55,6 +55,8 @@ struct clist_render_thread_control_s {
     gx_device *cdev;	/* clist device copy */
     gx_device *bdev;	/* this thread's buffer device */
     int band;
+    int band_begin_line;	/* lines rendered by an in-order worker: the */
+    int band_end_line;		/* whole band, or part of it if it was split */
     gp_thread_id thread;
 
     /* For process_page mode */
@@ -65,4 +67,49 @@ struct clist_render_thread_control_s {
 #endif
 };
 
+/* Number of band slots (the reorder buffer) per rendering thread when the   */
+/* output must be delivered in order. Values > 1 let idle threads render     */
+/* bands beyond a slow one instead of waiting for it to be output.           */
+#ifndef CLIST_RENDER_SLOTS_PER_THREAD
+#  define CLIST_RENDER_SLOTS_PER_THREAD 2
+#endif
+
+/* With AdaptiveBanding, a band whose recorded command list costs more than */
+/* CLIST_BAND_SPLIT_RATIO times the average for the page is rendered as up  */
+/* to CLIST_BAND_SPLIT_MAX sub-bands, which the workers can do in parallel. */
+#ifndef CLIST_BAND_SPLIT_RATIO
+#  define CLIST_BAND_SPLIT_RATIO 2
+#endif
+#ifndef CLIST_BAND_SPLIT_MAX
+#  define CLIST_BAND_SPLIT_MAX 4
+#endif
+
+/* Scheduler used when bands must be delivered in order (output_fn != NULL  */
+/* or get_bits). The page is divided into render units (normally the bands, */
+/* see above). A pool of worker threads claims units in delivery order,     */
+/* each into band slot (seq % num_render_threads) of the reader, so the     */
+/* number of slots bounds how far rendering can run ahead of the output.    */
+typedef struct clist_render_worker_s {
+    struct gx_device_clist_reader_s *crdev;	/* the main (interpreter thread) device */
+    gp_thread_id thread;
+    gx_semaphore_t *wake;	/* signalled when this idle worker may claim a band */
+} clist_render_worker_t;
+
+struct clist_render_sched_s {
+    gx_monitor_t *lock;		/* protects all of the following except band_time */
+    int num_workers;
+    clist_render_worker_t workers[MAX_THREADS];
+    int num_idle;		/* workers waiting for a slot to be delivered */
+    int idle[MAX_THREADS];	/* indices of those workers */
+    int num_units;		/* number of render units on the page */
+    int *unit_y;		/* first line of each unit, plus the page height */
+    int first_unit;		/* unit for sequence number 0 */
+    int direction;		/* +1 or -1 */
+    int num_seq;		/* number of units to render in this direction */
+    int next_seq;		/* next sequence number to be claimed by a worker */
+    int deliver_seq;		/* next sequence number to be delivered */
+    bool abort;			/* workers exit instead of claiming more units */
+    long *band_time;		/* elapsed render time per unit, in microseconds */
+};
+
 #endif /* gxclthrd_INCLUDED */
@@ -409,6 +409,8 @@ cmd_put_list_op(gx_device_clist_writer * cldev, cmd_list * pcl, uint size)
         cldev->ccl = pcl;
         cp->size = size;
     }
+    pcl->cmd_bytes += size;
+    pcl->cmd_ops++;
     cldev->cnext = dp + size;
     return dp;
 }
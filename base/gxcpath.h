@@ -132,6 +132,7 @@ void gx_device_clip_finalize(const gs_memory_t *cmem, void *vpdev);
     gx_device_clip_finalize)
 void gx_make_clip_device_on_stack(gx_device_clip * dev, const gx_clip_path *pcpath, gx_device *target);
 void gx_destroy_clip_device_on_stack(gx_device_clip * dev);
+bool gx_device_is_clip(const gx_device *dev);
 gx_device *gx_make_clip_device_on_stack_if_needed(gx_device_clip * dev, const gx_clip_path *pcpath, gx_device *target, gs_fixed_rect *rect);
 void gx_make_clip_device_in_heap(gx_device_clip * dev, const gx_clip_path *pcpath, gx_device *target,
                               gs_memory_t *mem);
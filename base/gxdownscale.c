@@ -20,6 +20,9 @@
 #include "gdevprn.h"
 #include "assert_.h"
 #include "gsicc_cache.h"
+#ifdef HAVE_SSE2
+#include <emmintrin.h>
+#endif
 
 #ifdef WITH_CAL
 #include "cal_ets.h"
@@ -1520,6 +1523,158 @@ static void down_core8_3_4(gx_downscaler_t *ds,
     }
 }
 
+#ifdef HAVE_SSE2
+/* SSE2 box filters for 8 bit data with 1, 3 or 4 components. The factor
+ * rows are summed 16 samples at a time into a small buffer of 16 bit
+ * column sums, and then the factor columns of each box are added up. This
+ * is done a chunk at a time, so the buffer can live on the stack and the
+ * cores remain safe to call from several threads at once. The results are
+ * exactly those of the scalar cores. */
+#define BOX_CHUNK 1024
+
+/* Sum the boxes for nout output pixels (nout * factor * nc <= BOX_CHUNK)
+ * into sums. */
+static inline void
+box_sums_sse2(bits16 *sums, const byte *inp, int span, int nout,
+              const int factor, const int nc)
+{
+    bits16 col[BOX_CHUNK];
+    const __m128i zero = _mm_setzero_si128();
+    const int step = factor * nc;
+    int ns = nout * step;
+    int i, x, c, k, y;
+
+    for (i = 0; i + 16 <= ns; i += 16)
+    {
+        const byte *p = inp + i;
+        __m128i lo = zero, hi = zero;
+
+        for (y = factor; y > 0; y--)
+        {
+            __m128i v = _mm_loadu_si128((const __m128i *)p);
+
+            lo = _mm_add_epi16(lo, _mm_unpacklo_epi8(v, zero));
+            hi = _mm_add_epi16(hi, _mm_unpackhi_epi8(v, zero));
+            p += span;
+        }
+        _mm_storeu_si128((__m128i *)(col + i), lo);
+        _mm_storeu_si128((__m128i *)(col + i + 8), hi);
+    }
+    for (; i < ns; i++)
+    {
+        const byte *p = inp + i;
+        int v = 0;
+
+        for (y = factor; y > 0; y--)
+        {
+            v += *p;
+            p += span;
+        }
+        col[i] = v;
+    }
+
+    for (x = 0; x < ns; x += step)
+    {
+        for (c = 0; c < nc; c++)
+        {
+            int v = 0;
+
+            for (k = 0; k < factor; k++)
+                v += col[x + k*nc + c];
+            *sums++ = v;
+        }
+    }
+}
+
+static inline void
+box_filter_sse2(byte *outp, const byte *inp, int span, int nout,
+                const int factor, const int nc)
+{
+    bits16 sums[BOX_CHUNK/2];
+    const int div = factor * factor;
+    const int chunk = BOX_CHUNK / (factor * nc);
+
+    while (nout > 0)
+    {
+        int n = nout < chunk ? nout : chunk;
+        int i;
+
+        box_sums_sse2(sums, inp, span, n, factor, nc);
+        for (i = 0; i < n * nc; i++)
+            *outp++ = (sums[i] + (div>>1))/div;
+        inp += n * factor * nc;
+        nout -= n;
+    }
+}
+
+static void
+pad_white_sse2(gx_downscaler_t *ds, byte *in_buffer, int span, int nc)
+{
+    int factor = ds->factor;
+    int pad_white = (ds->awidth - ds->width) * factor * nc;
+    int y;
+
+    if (pad_white > 0)
+    {
+        byte *inp = in_buffer + ds->width*factor*nc;
+        for (y = factor; y > 0; y--)
+        {
+            memset(inp, 0xFF, pad_white);
+            inp += span;
+        }
+    }
+}
+
+static inline void
+down_core8_n_sse2(gx_downscaler_t *ds, byte *outp, byte *in_buffer,
+                  int span, const int nc)
+{
+    pad_white_sse2(ds, in_buffer, span, nc);
+    switch (ds->factor)
+    {
+        case 2:
+            box_filter_sse2(outp, in_buffer, span, ds->awidth, 2, nc);
+            break;
+        case 3:
+            box_filter_sse2(outp, in_buffer, span, ds->awidth, 3, nc);
+            break;
+        default:
+            box_filter_sse2(outp, in_buffer, span, ds->awidth, 4, nc);
+            break;
+    }
+}
+
+static void down_core8_sse2(gx_downscaler_t *ds,
+                            byte            *outp,
+                            byte            *in_buffer,
+                            int              row,
+                            int              plane,
+                            int              span)
+{
+    down_core8_n_sse2(ds, outp, in_buffer, span, 1);
+}
+
+static void down_core24_sse2(gx_downscaler_t *ds,
+                             byte            *outp,
+                             byte            *in_buffer,
+                             int              row,
+                             int              plane,
+                             int              span)
+{
+    down_core8_n_sse2(ds, outp, in_buffer, span, 3);
+}
+
+static void down_core32_sse2(gx_downscaler_t *ds,
+                             byte            *outp,
+                             byte            *in_buffer,
+                             int              row,
+                             int              plane,
+                             int              span)
+{
+    down_core8_n_sse2(ds, outp, in_buffer, span, 4);
+}
+#endif /* HAVE_SSE2 */
+
 /* RGB downscale (no error diffusion) code */
 
 static void down_core24(gx_downscaler_t *ds,
@@ -2242,6 +2397,41 @@ do_alloc_liner(gs_memory_t *mem, size_t size, const char *type,
     return 0;
 }
 
+static gx_downscale_core *
+select_8_to_8_core(int nc, int factor)
+{
+    if (factor == 1)
+        return NULL; /* No sense doing anything */
+#ifdef HAVE_SSE2
+    if (factor >= 2 && factor <= 4)
+    {
+        if (nc == 1)
+            return &down_core8_sse2;
+        else if (nc == 3)
+            return &down_core24_sse2;
+        else if (nc == 4)
+            return &down_core32_sse2;
+    }
+#endif
+    if (nc == 1)
+    {
+        if (factor == 4)
+            return &down_core8_4;
+        else if (factor == 3)
+            return &down_core8_3;
+        else if (factor == 2)
+            return &down_core8_2;
+        else
+            return &down_core8;
+    }
+    else if (nc == 3)
+        return &down_core24;
+    else if (nc == 4)
+        return &down_core32;
+
+    return NULL;
+}
+
 int gx_downscaler_init_planar_cm(gx_downscaler_t      *ds,
                                  gx_device            *dev,
                                  int                   src_bpc,
@@ -2492,14 +2682,8 @@ int gx_downscaler_init_planar_cm(gx_downscaler_t      *ds,
         core = NULL;
     else if (src_bpc == 16)
         core = &down_core16;
-    else if (factor == 4)
-        core = &down_core8_4;
-    else if (factor == 3)
-        core = &down_core8_3;
-    else if (factor == 2)
-        core = &down_core8_2;
     else
-        core = &down_core8;
+        core = select_8_to_8_core(1, factor);
     ds->down_core = core;
 
     if (mfs > 1) {
@@ -2579,30 +2763,6 @@ int gx_downscaler_init_cm(gx_downscaler_t      *ds,
                                           params->ets ? &bogus_ets_halftone : NULL);
 }
 
-static gx_downscale_core *
-select_8_to_8_core(int nc, int factor)
-{
-    if (factor == 1)
-        return NULL; /* No sense doing anything */
-    if (nc == 1)
-    {
-        if (factor == 4)
-            return &down_core8_4;
-        else if (factor == 3)
-            return &down_core8_3;
-        else if (factor == 2)
-            return &down_core8_2;
-        else
-            return &down_core8;
-    }
-    else if (nc == 3)
-        return &down_core24;
-    else if (nc == 4)
-        return &down_core32;
-
-    return NULL;
-}
-
 int
 gx_downscaler_init_cm_halftone(gx_downscaler_t      *ds,
                                gx_device            *dev,
@@ -3342,21 +3502,8 @@ int gx_downscaler_process_page(gx_device                 *dev,
     }
     else if (factor == 1)
         core = NULL;
-    else if ((src_bpc == 8) && (num_comps == 1))
-    {
-        if (factor == 4)
-            core = &down_core8_4;
-        else if (factor == 3)
-            core = &down_core8_3;
-        else if (factor == 2)
-            core = &down_core8_2;
-        else
-            core = &down_core8;
-    }
-    else if ((src_bpc == 8) && (num_comps == 3))
-        core = &down_core24;
-    else if ((src_bpc == 8) && (num_comps == 4))
-         core = &down_core32;
+    else if ((src_bpc == 8) && (num_comps == 1 || num_comps == 3 || num_comps == 4))
+        core = select_8_to_8_core(num_comps, factor);
     else {
         return gs_note_error(gs_error_rangecheck);
     }
@@ -3371,6 +3518,392 @@ int gx_downscaler_process_page(gx_device                 *dev,
     return dev_proc(dev, process_page)(dev, &my_options);
 }
 
+/* gx_downscaler_process_rows: the band at a time version of a loop over
+ * gx_downscaler_getbits.
+ *
+ * process_fn (run by the rendering threads, if there are any) box filters
+ * the whole output rows within its band into the band's buffer. For error
+ * diffused mono output it stores the box sums instead, and output_fn does
+ * the error diffusion, as that has to run down the page in order. The
+ * input lines of a row that straddles 2 (or more) bands are copied into the
+ * band buffers as 'head' and 'tail' lines, and output_fn gathers them in
+ * 'carry' to do that row itself. */
+typedef struct downscaler_rows_arg_s
+{
+    gx_downscaler_t      *ds;
+    gx_downscaler_row_fn *row_fn;
+    void                 *row_arg;
+    int                   height;      /* Number of output rows */
+    int                   mono;        /* Error diffused 1bpp output */
+    int                   row_size;    /* Bytes per row in the band buffer */
+    byte                 *carry;       /* Lines of a row split across bands */
+    int                   carry_lines;
+    byte                 *sums;        /* Box sums of a carried row */
+    byte                 *out;         /* An error diffused row */
+    byte                 *bits;        /* Unpacked error diffused row */
+}
+downscaler_rows_arg_t;
+
+typedef struct downscaler_rows_buffer_s
+{
+    int   y;                           /* First line of the band */
+    int   head_lines;                  /* Lines before the first whole row */
+    int   first_row;                   /* First whole output row */
+    int   num_rows;                    /* Number of whole output rows */
+    int   tail_lines;                  /* Lines after the last whole row */
+    byte *head;
+    byte *tail;
+    byte *data;                        /* Downscaled rows (or box sums) */
+}
+downscaler_rows_buffer_t;
+
+/* Sum the factor x factor boxes of a row of 8 bit gray. */
+static void
+down_box_sums(gx_downscaler_t *ds, bits16 *sums, const byte *inp, int span)
+{
+    int factor = ds->factor;
+    int awidth = ds->awidth;
+#ifdef HAVE_SSE2
+    int chunk = BOX_CHUNK / factor;
+
+    while (awidth > 0)
+    {
+        int n = awidth < chunk ? awidth : chunk;
+
+        switch (factor)
+        {
+            case 2:
+                box_sums_sse2(sums, inp, span, n, 2, 1);
+                break;
+            case 3:
+                box_sums_sse2(sums, inp, span, n, 3, 1);
+                break;
+            case 4:
+                box_sums_sse2(sums, inp, span, n, 4, 1);
+                break;
+            default:
+                box_sums_sse2(sums, inp, span, n, factor, 1);
+                break;
+        }
+        sums += n;
+        inp += n * factor;
+        awidth -= n;
+    }
+#else
+    int x, xx, y, value;
+    const int back = span * factor - 1;
+
+    for (x = awidth; x > 0; x--)
+    {
+        value = 0;
+        for (xx = factor; xx > 0; xx--)
+        {
+            for (y = factor; y > 0; y--)
+            {
+                value += *inp;
+                inp += span;
+            }
+            inp -= back;
+        }
+        *sums++ = value;
+    }
+#endif
+}
+
+/* The error diffusion of down_core, from box sums. */
+static void
+down_core_sums(gx_downscaler_t *ds, byte *out_buffer, byte *outp,
+               const bits16 *sums, int row)
+{
+    int        x, value;
+    int        e_downleft, e_down, e_forward = 0;
+    int        awidth    = ds->awidth;
+    int        factor    = ds->factor;
+    int       *errors    = ds->errors;
+    const int  threshold = factor*factor*128;
+    const int  max_value = factor*factor*255;
+
+    if ((row & 1) == 0)
+    {
+        /* Left to Right pass (no min feature size) */
+        errors += 2;
+        for (x = awidth; x > 0; x--)
+        {
+            value = e_forward + *errors + *sums++;
+            if (value >= threshold)
+            {
+                *outp++ = 1;
+                value -= max_value;
+            }
+            else
+            {
+                *outp++ = 0;
+            }
+            e_forward  = value * 7/16;
+            e_downleft = value * 3/16;
+            e_down     = value * 5/16;
+            value     -= e_forward + e_downleft + e_down;
+            errors[-2] += e_downleft;
+            errors[-1] += e_down;
+            *errors++   = value;
+        }
+        outp -= awidth;
+    }
+    else
+    {
+        /* Right to Left pass (no min feature size) */
+        errors += awidth;
+        sums += awidth-1;
+        outp += awidth-1;
+        for (x = awidth; x > 0; x--)
+        {
+            value = e_forward + *errors + *sums--;
+            if (value >= threshold)
+            {
+                *outp-- = 1;
+                value -= max_value;
+            }
+            else
+            {
+                *outp-- = 0;
+            }
+            e_forward  = value * 7/16;
+            e_downleft = value * 3/16;
+            e_down     = value * 5/16;
+            value     -= e_forward + e_downleft + e_down;
+            errors[2] += e_downleft;
+            errors[1] += e_down;
+            *errors--   = value;
+        }
+        outp++;
+    }
+    pack_8to1(out_buffer, outp, awidth);
+}
+
+static int downscaler_rows_init_fn(void *arg_, gx_device *dev, gs_memory_t *memory, int w, int h, void **pbuffer)
+{
+    downscaler_rows_arg_t *arg = (downscaler_rows_arg_t *)arg_;
+    gx_downscaler_t *ds = arg->ds;
+    downscaler_rows_buffer_t *buffer;
+    size_t lines = ds->factor - 1;
+    size_t rows = h / ds->factor + 1;
+
+    buffer = (downscaler_rows_buffer_t *)gs_alloc_bytes(memory, sizeof(*buffer), "downscaler rows buffer");
+    if (buffer == NULL)
+        return_error(gs_error_VMerror);
+    memset(buffer, 0, sizeof(*buffer));
+    buffer->head = gs_alloc_bytes(memory, lines * 2 * ds->span + rows * arg->row_size,
+                                  "downscaler rows buffer(data)");
+    if (buffer->head == NULL) {
+        gs_free_object(memory, buffer, "downscaler rows buffer");
+        return_error(gs_error_VMerror);
+    }
+    buffer->tail = buffer->head + lines * ds->span;
+    buffer->data = buffer->tail + lines * ds->span;
+
+    *pbuffer = (void *)buffer;
+    return 0;
+}
+
+static void
+downscaler_rows_free_fn(void *arg_, gx_device *dev, gs_memory_t *memory, void *buffer_)
+{
+    downscaler_rows_buffer_t *buffer = (downscaler_rows_buffer_t *)buffer_;
+
+    if (buffer == NULL)
+        return;
+    gs_free_object(memory, buffer->head, "downscaler rows buffer(data)");
+    gs_free_object(memory, buffer, "downscaler rows buffer");
+}
+
+static void
+copy_lines(byte *dst, int dst_raster, const byte *src, int src_raster, int n, int size)
+{
+    for (; n > 0; n--) {
+        memcpy(dst, src, size);
+        dst += dst_raster;
+        src += src_raster;
+    }
+}
+
+static int downscaler_rows_process_fn(void *arg_, gx_device *dev, gx_device *bdev, const gs_int_rect *rect, void *buffer_)
+{
+    downscaler_rows_arg_t *arg = (downscaler_rows_arg_t *)arg_;
+    downscaler_rows_buffer_t *buffer = (downscaler_rows_buffer_t *)buffer_;
+    gx_downscaler_t *ds = arg->ds;
+    int factor = ds->factor;
+    int size = gdev_mem_bytes_per_scan_line(dev);
+    int code, raster, first, full, i;
+    gs_get_bits_params_t params;
+    gs_int_rect in_rect;
+    byte *in_ptr;
+
+    in_rect.p.x = 0;
+    in_rect.p.y = 0;
+    in_rect.q.x = rect->q.x - rect->p.x;
+    in_rect.q.y = rect->q.y - rect->p.y;
+    params.options = GB_COLORS_NATIVE | GB_ALPHA_NONE | GB_PACKING_CHUNKY | GB_RETURN_POINTER | GB_ALIGN_ANY | GB_OFFSET_0 | GB_RASTER_ANY;
+    code = dev_proc(bdev, get_bits_rectangle)(bdev, &in_rect, &params);
+    if (code < 0)
+        return code;
+    /* A returned pointer only reports its raster when it isn't standard. */
+    raster = (params.options & GB_RASTER_SPECIFIED ? params.raster :
+              gx_device_raster(bdev, true));
+    in_ptr = params.data[0];
+
+    first = (rect->p.y + factor - 1) / factor * factor;
+    if (first > rect->q.y)
+        first = rect->q.y;
+    full = (rect->q.y - first) / factor;
+
+    buffer->y = rect->p.y;
+    buffer->head_lines = first - rect->p.y;
+    buffer->first_row = first / factor;
+    buffer->num_rows = full;
+    if (buffer->first_row + buffer->num_rows > arg->height)
+        buffer->num_rows = max(arg->height - buffer->first_row, 0);
+    buffer->tail_lines = rect->q.y - (first + full * factor);
+
+    copy_lines(buffer->head, ds->span, in_ptr, raster, buffer->head_lines, size);
+    in_ptr += (size_t)raster * buffer->head_lines;
+    for (i = 0; i < buffer->num_rows; i++) {
+        byte *out_ptr = buffer->data + (size_t)i * arg->row_size;
+
+        if (arg->mono)
+            down_box_sums(ds, (bits16 *)out_ptr, in_ptr, raster);
+        else
+            ds->down_core(ds, out_ptr, in_ptr, buffer->first_row + i, 0, raster);
+        in_ptr += (size_t)raster * factor;
+    }
+    in_ptr += (size_t)raster * factor * (full - buffer->num_rows);
+    copy_lines(buffer->tail, ds->span, in_ptr, raster, buffer->tail_lines, size);
+
+    return 0;
+}
+
+static int
+downscaler_rows_output_row(downscaler_rows_arg_t *arg, byte *data, int row)
+{
+    if (row >= arg->height)
+        return 0;
+    if (arg->mono) {
+        down_core_sums(arg->ds, arg->out, arg->bits, (const bits16 *)data, row);
+        data = arg->out;
+    }
+    return arg->row_fn(arg->row_arg, data, row);
+}
+
+static int
+downscaler_rows_output_fn(void *arg_, gx_device *dev, void *buffer_)
+{
+    downscaler_rows_arg_t *arg = (downscaler_rows_arg_t *)arg_;
+    downscaler_rows_buffer_t *buffer = (downscaler_rows_buffer_t *)buffer_;
+    gx_downscaler_t *ds = arg->ds;
+    int factor = ds->factor;
+    int size = gdev_mem_bytes_per_scan_line(dev);
+    int code = 0;
+    int i;
+
+    if (buffer->head_lines > 0) {
+        copy_lines(arg->carry + (size_t)arg->carry_lines * ds->span, ds->span,
+                   buffer->head, ds->span, buffer->head_lines, size);
+        arg->carry_lines += buffer->head_lines;
+        if (arg->carry_lines == factor) {
+            int row = (buffer->y + buffer->head_lines) / factor - 1;
+
+            if (arg->mono)
+                down_box_sums(ds, (bits16 *)arg->sums, arg->carry, ds->span);
+            else
+                ds->down_core(ds, arg->sums, arg->carry, row, 0, ds->span);
+            code = downscaler_rows_output_row(arg, arg->sums, row);
+            arg->carry_lines = 0;
+        }
+    }
+    for (i = 0; i < buffer->num_rows && code >= 0; i++)
+        code = downscaler_rows_output_row(arg, buffer->data + (size_t)i * arg->row_size,
+                                          buffer->first_row + i);
+    if (buffer->tail_lines > 0) {
+        copy_lines(arg->carry, ds->span, buffer->tail, ds->span, buffer->tail_lines, size);
+        arg->carry_lines = buffer->tail_lines;
+    }
+    return code;
+}
+
+int gx_downscaler_process_rows(gx_downscaler_t      *ds,
+                               int                   height,
+                               gx_downscaler_row_fn *row_fn,
+                               void                 *row_arg)
+{
+    downscaler_rows_arg_t arg = { 0 };
+    gx_process_page_options_t options = { 0 };
+    gx_downscale_core *core = ds->down_core;
+    gs_memory_t *mem = ds->dev->memory;
+    int upfactor, downfactor, banded, row, code = 0;
+    byte *data;
+
+    gx_downscaler_decode_factor(ds->factor, &upfactor, &downfactor);
+    arg.mono = (core == &down_core || core == &down_core_2 ||
+                core == &down_core_3 || core == &down_core_4);
+    banded = upfactor == 1 && ds->factor > 1 && ds->num_planes == 0 &&
+             ds->apply_cm == NULL && ds->mfs_data == NULL &&
+             ds->ets_config == NULL && ds->ht == NULL &&
+             ds->awidth == ds->width &&
+             ds->liner != NULL && ds->liner->get_line == getbits_chunky_line &&
+             (arg.mono || core == &down_core8 || core == &down_core8_2 ||
+              core == &down_core8_3 || core == &down_core8_4 ||
+              core == &down_core24 || core == &down_core32 ||
+              core == &down_core16
+#ifdef HAVE_SSE2
+              || core == &down_core8_sse2 || core == &down_core24_sse2 ||
+              core == &down_core32_sse2
+#endif
+              );
+
+    if (!banded) {
+        int nc = max(ds->num_comps, ds->post_cm_num_comps);
+
+        data = gs_alloc_bytes(mem, max(ds->span, bitmap_raster(ds->awidth * nc * ds->dst_bpc)),
+                              "gx_downscaler_process_rows(data)");
+        if (data == NULL)
+            return_error(gs_error_VMerror);
+        for (row = 0; row < height && code >= 0; row++) {
+            code = gx_downscaler_getbits(ds, data, row);
+            if (code >= 0)
+                code = row_fn(row_arg, data, row);
+        }
+        gs_free_object(mem, data, "gx_downscaler_process_rows(data)");
+        return code;
+    }
+
+    arg.ds = ds;
+    arg.row_fn = row_fn;
+    arg.row_arg = row_arg;
+    arg.height = height;
+    if (arg.mono)
+        arg.row_size = ds->awidth * sizeof(bits16);
+    else
+        arg.row_size = bitmap_raster(ds->awidth * ds->num_comps * ds->dst_bpc);
+    arg.carry = gs_alloc_bytes(mem, (size_t)ds->span * ds->factor +
+                                    arg.row_size + ds->awidth + ds->span,
+                               "gx_downscaler_process_rows(carry)");
+    if (arg.carry == NULL)
+        return_error(gs_error_VMerror);
+    arg.sums = arg.carry + (size_t)ds->span * ds->factor;
+    arg.bits = arg.sums + arg.row_size;
+    arg.out = arg.bits + ds->awidth;
+
+    options.init_buffer_fn = downscaler_rows_init_fn;
+    options.free_buffer_fn = downscaler_rows_free_fn;
+    options.process_fn = downscaler_rows_process_fn;
+    options.output_fn = downscaler_rows_output_fn;
+    options.arg = &arg;
+
+    code = dev_proc(ds->dev, process_page)(ds->dev, &options);
+
+    gs_free_object(mem, arg.carry, "gx_downscaler_process_rows(carry)");
+    return code;
+}
+
 int gx_downscaler_read_params(gs_param_list        *plist,
                               gx_downscaler_params *params,
                               int                   features)
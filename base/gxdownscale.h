@@ -231,6 +231,22 @@ int gx_downscaler_process_page(gx_device                 *dev,
                                gx_process_page_options_t *options,
                                int                        factor);
 
+/* Function type for the rows delivered by gx_downscaler_process_rows.
+ * data is one downscaled row, as gx_downscaler_getbits would give it. */
+typedef int (gx_downscaler_row_fn)(void *arg, byte *data, int row);
+
+/* Downscale rows 0 to height-1 of the page, as successive calls to
+ * gx_downscaler_getbits would, and pass them to row_fn in order. When
+ * there is no trapping, min feature size, halftoning, deskewing, color
+ * management or width adjustment to do, and the factor is a whole number,
+ * the box filtering is done a band at a time by the device's process_page,
+ * and so by the rendering threads if there are any. Only any error
+ * diffusion and row_fn itself are then left to the calling thread. */
+int gx_downscaler_process_rows(gx_downscaler_t      *ds,
+                               int                   height,
+                               gx_downscaler_row_fn *row_fn,
+                               void                 *row_arg);
+
 #define GX_DOWNSCALER_PARAMS_DEFAULTS \
 { 1, 0, 0, 0, { 3, 1, 0, 2 }, 0, 0 }
 
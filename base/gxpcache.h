@@ -20,12 +20,15 @@
 #  define gxpcache_INCLUDED
 
 #include "std.h"
+#include "stdint_.h"
 #include "gsdcolor.h"
 
 /*
- * Define a cache for rendered Patterns.  This is currently an open
- * hash table with single probing (no reprobing) and round-robin
- * replacement.  Obviously, we can do better in both areas.
+ * Define a cache for rendered Patterns.  Each tile prefers the slot
+ * (id % num_tiles), but may live in any slot of the table.  The cache
+ * is bounded both by the number of slots and by max_bits, the number
+ * of bytes held by cached tiles; when either runs out, the least
+ * recently used unlocked tile is replaced.
  */
 typedef struct gx_pattern_cache_s gx_pattern_cache;
 
@@ -34,9 +37,13 @@ struct gx_pattern_cache_s {
     gx_color_tile *tiles;
     uint num_tiles;
     uint tiles_used;
-    uint next;			/* round-robin index */
     size_t bits_used;
     size_t max_bits;
+    uint64_t clock;		/* source of tile lru_stamp values */
+    /* Statistics, for the PatternCache* system parameters. */
+    ulong hits;			/* pattern loads satisfied from the cache */
+    ulong misses;		/* pattern loads that rendered the tile */
+    ulong evictions;		/* tiles dropped to make room */
     void (*free_all) (gx_pattern_cache *);
 };
 
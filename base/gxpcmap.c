@@ -48,8 +48,8 @@ unsigned int global_pat_index = 0;
 #endif
 
 /* Define the default size of the Pattern cache. */
-#define max_cached_patterns_LARGE 50
-#define max_pattern_bits_LARGE 100000
+#define max_cached_patterns_LARGE 200
+#define max_pattern_bits_LARGE 8000000
 #define max_cached_patterns_SMALL 5
 #define max_pattern_bits_SMALL 1000
 uint
@@ -835,9 +835,12 @@ gx_pattern_alloc_cache(gs_memory_t * mem, uint num_tiles, ulong max_bits)
     pcache->tiles = tiles;
     pcache->num_tiles = num_tiles;
     pcache->tiles_used = 0;
-    pcache->next = 0;
     pcache->bits_used = 0;
     pcache->max_bits = max_bits;
+    pcache->clock = 0;
+    pcache->hits = 0;
+    pcache->misses = 0;
+    pcache->evictions = 0;
     pcache->free_all = pattern_cache_free_all;
     for (i = 0; i < num_tiles; tiles++, i++) {
         tiles->id = gx_no_bitmap_id;
@@ -862,6 +865,7 @@ gx_pattern_alloc_cache(gs_memory_t * mem, uint num_tiles, ulong max_bits)
         tiles->tmask.data = 0;
 #endif
         tiles->index = i;
+        tiles->lru_stamp = 0;
         tiles->cdev = NULL;
         tiles->ttrans = NULL;
         tiles->num_planar_planes = 0;
@@ -891,6 +895,10 @@ gx_pattern_cache_free(gx_pattern_cache *pcache)
 {
     if (pcache == NULL)
         return;
+    if_debug5m('v', pcache->memory,
+               "[v]Pattern cache: %lu hits, %lu misses, %lu evictions, %"PRIuSIZE" of %"PRIuSIZE" bytes\n",
+               pcache->hits, pcache->misses, pcache->evictions,
+               pcache->bits_used, pcache->max_bits);
     pattern_cache_free_all(pcache);
     gs_free_object(pcache->memory, pcache->tiles, "gx_pattern_cache_free");
     pcache->tiles = NULL;
@@ -989,39 +997,86 @@ gx_pattern_cache_free_entry(gx_pattern_cache * pcache, gx_color_tile * ctile, bo
 }
 
 /*
-    Historically, the pattern cache has used a very simple hashing
-    scheme whereby pattern A goes into slot idx = (A.id % num_tiles).
-    Unfortunately, now we allow tiles to be 'locked' into the
-    pattern cache, we might run into the case where we want both
-    tiles A and B to be in the cache at once where:
-      (A.id % num_tiles) == (B.id % num_tiles).
-
-    We have a maximum of 2 locked tiles, and one of those can be
-    placed while the other one is locked. So we only need to cope
-    with a single 'collision'.
-
-    We therefore allow tiles to either go in at idx or at
-    (idx + 1) % num_tiles. This means we need to be prepared to
-    search a bit further for them, hence we now have 2 helper
-    functions to do this.
+    Historically, the pattern cache used a very simple hashing
+    scheme whereby pattern A went into slot idx = (A.id % num_tiles),
+    with round-robin replacement. That evicts tiles that are still
+    in use whenever two ids collide, which hurts documents that reuse
+    a handful of patterns (hatchings and the like) on every page.
+
+    A tile now prefers slot (A.id % num_tiles), but may be placed in
+    any slot. Lookups start at the preferred slot, so in the common
+    case they still succeed on the first probe. When a new tile has
+    to be placed, we take the first free slot, or failing that the
+    least recently used slot that is not locked (tiles can be 'locked'
+    into the cache for fill_stroke_path).
 */
 
-/* We can have at most 1 locked tile while looking for a place to
- * put another tile. */
 gx_color_tile *
 gx_pattern_cache_find_tile_for_id(gx_pattern_cache *pcache, gs_id id)
 {
-    gx_color_tile *ctile  = &pcache->tiles[id % pcache->num_tiles];
-    gx_color_tile *ctile2 = &pcache->tiles[(id+1) % pcache->num_tiles];
-    if (ctile->id == id || ctile->id == gs_no_id)
-        return ctile;
-    if (ctile2->id == id || ctile2->id == gs_no_id)
-        return ctile2;
-    if (!ctile->is_locked)
-        return ctile;
-    return ctile2;
+    uint home = id % pcache->num_tiles;
+    gx_color_tile *empty = NULL, *victim = NULL;
+    uint i;
+
+    for (i = 0; i < pcache->num_tiles; i++) {
+        gx_color_tile *ctile = &pcache->tiles[(home + i) % pcache->num_tiles];
+
+        if (ctile->id == id)
+            return ctile;
+        if (ctile->id == gx_no_bitmap_id) {
+            if (empty == NULL)
+                empty = ctile;
+        } else if (!ctile->is_locked &&
+                   (victim == NULL || ctile->lru_stamp < victim->lru_stamp))
+            victim = ctile;
+    }
+    if (empty != NULL)
+        return empty;
+    if (victim != NULL)
+        return victim;
+    return &pcache->tiles[home];
 }
 
+/* Find the slot for a new tile with the given id, and empty it. */
+static gx_color_tile *
+gx_pattern_cache_alloc_tile(gx_pattern_cache *pcache, gs_id id)
+{
+    gx_color_tile *ctile = gx_pattern_cache_find_tile_for_id(pcache, id);
+
+    if (ctile->id != gx_no_bitmap_id && ctile->id != id && !ctile->is_locked)
+        pcache->evictions++;
+    gx_pattern_cache_free_entry(pcache, ctile, false);   /* ensure that this cache slot is empty */
+    ctile->lru_stamp = ++pcache->clock;
+    return ctile;
+}
+
+/* Free the least recently used entries until 'needed' more bytes fit */
+/* into the budget (or nothing is left to free).                      */
+static void
+pattern_cache_make_room(gx_pattern_cache *pcache, size_t needed)
+{
+    while (pcache->bits_used + needed > pcache->max_bits &&
+           pcache->bits_used != 0) {
+        gx_color_tile *victim = NULL;
+        uint i;
+
+        for (i = 0; i < pcache->num_tiles; i++) {
+            gx_color_tile *ctile = &pcache->tiles[i];
+
+            /* A pattern may be temporarily locked (stroke pattern for */
+            /* fill_stroke_path), and dummy or empty tiles free nothing. */
+            if (ctile->id == gx_no_bitmap_id || ctile->is_locked ||
+                ctile->is_dummy || ctile->bits_used == 0)
+                continue;
+            if (victim == NULL || ctile->lru_stamp < victim->lru_stamp)
+                victim = ctile;
+        }
+        if (victim == NULL)
+            break;		/* only locked entries left */
+        gx_pattern_cache_free_entry(pcache, victim, false);
+        pcache->evictions++;
+    }
+}
 
 /* Given the size of a new pattern tile, free entries from the cache until  */
 /* enough space is available (or nothing left to free).                     */
@@ -1030,27 +1085,21 @@ void
 gx_pattern_cache_ensure_space(gs_gstate * pgs, size_t needed)
 {
     int code = ensure_pattern_cache(pgs);
-    gx_pattern_cache *pcache;
-    int start_free_id;
 
     if (code < 0)
         return;                 /* no cache -- just exit */
 
-    pcache = pgs->pattern_cache;
-    start_free_id = pcache->next;	/* for scan wrap check */
-    /* If too large then start freeing entries */
-    /* By starting just after 'next', we attempt to first free the oldest entries */
-    while (pcache->bits_used + needed > pcache->max_bits &&
-           pcache->bits_used != 0) {
-        pcache->next = (pcache->next + 1) % pcache->num_tiles;
-        gx_pattern_cache_free_entry(pcache, &pcache->tiles[pcache->next], false);
-        /* since a pattern may be temporarily locked (stroke pattern for fill_stroke_path) */
-        /* we may not have freed all entries even though we've scanned the entire cache.   */
-        /* The following check for wrapping prevents infinite loop if stroke pattern was   */
-        /* larger than pcache->max_bits,                                                   */
-        if (pcache->next == start_free_id)
-            break;		/* we wrapped -- cache may not be empty */
-    }
+    pattern_cache_make_room(pgs->pattern_cache, needed);
+}
+
+/* Change the byte budget of the cache, freeing entries if it shrinks. */
+void
+gx_pattern_cache_set_max_bits(gx_pattern_cache *pcache, size_t max_bits)
+{
+    if (pcache == NULL)
+        return;
+    pcache->max_bits = max_bits;
+    pattern_cache_make_room(pcache, 0);
 }
 
 /* Export updating the pattern_cache bits_used and tiles_used for clist reading */
@@ -1167,8 +1216,7 @@ gx_pattern_cache_add_entry(gs_gstate * pgs,
         used = size_b + size_c;
     }
     id = pinst->id;
-    ctile = gx_pattern_cache_find_tile_for_id(pcache, id);
-    gx_pattern_cache_free_entry(pcache, ctile, false);         /* ensure that this cache slot is empty */
+    ctile = gx_pattern_cache_alloc_tile(pcache, id);
     ctile->id = id;
     ctile->num_planar_planes = pinst->num_planar_planes;
     ctile->depth = fdev->color_info.depth;
@@ -1255,8 +1303,7 @@ gx_pattern_cache_get_entry(gs_gstate * pgs, gs_id id, gx_color_tile ** pctile)
     if (code < 0)
         return code;
     pcache = pgs->pattern_cache;
-    ctile = gx_pattern_cache_find_tile_for_id(pcache, id);
-    gx_pattern_cache_free_entry(pgs->pattern_cache, ctile, false);
+    ctile = gx_pattern_cache_alloc_tile(pcache, id);
     ctile->id = id;
     *pctile = ctile;
     return 0;
@@ -1282,8 +1329,7 @@ gx_pattern_cache_add_dummy_entry(gs_gstate *pgs,
     if (code < 0)
         return code;
     pcache = pgs->pattern_cache;
-    ctile = gx_pattern_cache_find_tile_for_id(pcache, id);
-    gx_pattern_cache_free_entry(pcache, ctile, false);
+    ctile = gx_pattern_cache_alloc_tile(pcache, id);
     ctile->id = id;
     ctile->depth = depth;
     ctile->uid = pinst->templat.uid;
@@ -1452,6 +1498,33 @@ gx_pattern_cache_flush(gx_pattern_cache * pcache)
     }
 }
 
+/*
+ * Flush the entries that may refer to objects outside the cache: pattern
+ * clists (which point at their pattern instance), dummy tiles (which stand
+ * for a pattern the device holds itself) and transparency tiles that still
+ * own a pdf14 device. Plain raster tiles are self contained, and are kept
+ * so that an interpreter can reuse them on later pages.
+ */
+void
+gx_pattern_cache_flush_transient(gx_pattern_cache * pcache)
+{
+    uint i;
+
+    if (pcache == 0)            /* no cache created yet */
+        return;
+    for (i = 0; i < pcache->num_tiles; ++i) {
+        gx_color_tile *ctile = &pcache->tiles[i];
+
+        if (ctile->id == gx_no_bitmap_id)
+            continue;
+        if (ctile->cdev != NULL || ctile->is_dummy ||
+            (ctile->ttrans != NULL && ctile->ttrans->pdev14 != NULL)) {
+            ctile->is_locked = false;		/* force freeing */
+            gx_pattern_cache_free_entry(pcache, ctile, true);
+        }
+    }
+}
+
 /* blank the pattern accumulator device assumed to be in the graphics
    state */
 int
@@ -1514,8 +1587,11 @@ gx_pattern_load(gx_device_color * pdc, const gs_gstate * pgs,
         if ((code = ensure_pattern_cache((gs_gstate *) pgs))< 0)      /* break const for call */
             return code;
 
-    if (gx_pattern_cache_lookup(pdc, pgs, dev, select))
+    if (gx_pattern_cache_lookup(pdc, pgs, dev, select)) {
+        pgs->pattern_cache->hits++;
         return 0;
+    }
+    pgs->pattern_cache->misses++;
 
     /* Get enough space in the cache for this pattern (estimated if it is a clist) */
     gx_pattern_cache_ensure_space((gs_gstate *)pgs, gx_pattern_size_estimate(pinst, has_tags));
@@ -225,6 +225,7 @@ struct gx_color_tile_s {
     byte pad[2];		/* structure members alignment. */
     /* The following is neither key nor value. */
     uint index;			/* the index of the tile within the cache (for GC) */
+    uint64_t lru_stamp;		/* cache clock at the last use of the tile */
 };
 
 #define private_st_color_tile()	/* in gxpcmap.c */\
@@ -296,6 +297,9 @@ bool gx_device_is_pattern_accum(gx_device *dev);
 /* This will allow 1 oversized entry					    */
 void gx_pattern_cache_ensure_space(gs_gstate * pgs, size_t needed);
 
+/* Change the byte budget of the cache, freeing entries if it shrinks. */
+void gx_pattern_cache_set_max_bits(gx_pattern_cache *pcache, size_t max_bits);
+
 gx_color_tile *
 gx_pattern_cache_find_tile_for_id(gx_pattern_cache *pcache, gs_id id);
 
@@ -332,6 +336,10 @@ void gx_pattern_cache_winnow(gx_pattern_cache *,
 
 void gx_pattern_cache_flush(gx_pattern_cache * pcache);
 
+/* Flush the entries that may refer to objects outside the cache, */
+/* keeping plain raster tiles for reuse on later pages. */
+void gx_pattern_cache_flush_transient(gx_pattern_cache * pcache);
+
 bool gx_pattern_tile_is_clist(gx_color_tile *ptile);
 
 /* Return true if pattern-clist device (not pattern accumulator) */
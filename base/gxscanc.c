@@ -150,6 +150,155 @@ enum
     DIRN_DOWN = 1
 };
 
+/* Sorting of scanline intersections.
+ *
+ * Each row of the table is a list of records, 'width' ints each, which
+ * are sorted on their first int (the x coordinate), and then by 'cmp'.
+ * The few intersections of a typical scanline are handled by the short
+ * bubblesorts in the scan converters themselves. Longer rows are
+ * insertion sorted, and the long rows of complex art (maps, hatching,
+ * CAD drawings) are radix sorted on x, a byte at a time and only for
+ * as many bytes as the spread of x needs, before an insertion pass puts
+ * the records with equal x in order. Records that compare equal are
+ * identical, so the result is the same as with qsort.
+ */
+#define SORT_INSERTION_MAX 48
+
+static inline void
+insertion_sort_row(int * gs_restrict row, int rowlen, int width,
+                   int (*cmp)(const void *, const void *))
+{
+    int i, j, k, tmp[4];
+
+    for (i = 1; i < rowlen; i++) {
+        int *r = &row[i*width];
+
+        if (cmp(r - width, r) <= 0)
+            continue;
+        for (k = 0; k < width; k++)
+            tmp[k] = r[k];
+        j = i;
+        do {
+            for (k = 0; k < width; k++)
+                row[j*width+k] = row[(j-1)*width+k];
+            j--;
+        } while (j > 0 && cmp(&row[(j-1)*width], tmp) > 0);
+        for (k = 0; k < width; k++)
+            row[j*width+k] = tmp[k];
+    }
+}
+
+static void
+radix_sort_row(int * gs_restrict row, int rowlen, int width, int * gs_restrict buf)
+{
+    int count[256];
+    int *src = row, *dst = buf, *t;
+    int i, k, n, shift, min, max;
+    unsigned int range;
+
+    min = max = row[0];
+    for (i = 1; i < rowlen; i++) {
+        int x = row[i*width];
+        if (x < min)
+            min = x;
+        else if (x > max)
+            max = x;
+    }
+    range = (unsigned int)max - (unsigned int)min;
+    for (shift = 0; shift < 32 && (range >> shift) != 0; shift += 8) {
+        memset(count, 0, sizeof(count));
+        for (i = 0; i < rowlen; i++)
+            count[(((unsigned int)src[i*width] - min) >> shift) & 255]++;
+        for (i = 0, n = 0; i < 256; i++) {
+            int c = count[i];
+            count[i] = n;
+            n += c;
+        }
+        for (i = 0; i < rowlen; i++) {
+            const int *s = &src[i*width];
+            int *d = &dst[count[(((unsigned int)s[0] - min) >> shift) & 255]++ * width];
+            for (k = 0; k < width; k++)
+                d[k] = s[k];
+        }
+        t = src; src = dst; dst = t;
+    }
+    if (src != row)
+        memcpy(row, src, rowlen * width * sizeof(int));
+}
+
+/* Sort a row of more than a handful of records. buf is NULL, or has space
+ * for any row of the table. */
+static inline void
+sort_row(int * gs_restrict row, int rowlen, int width, int * gs_restrict buf,
+         int (*cmp)(const void *, const void *))
+{
+    if (rowlen > SORT_INSERTION_MAX) {
+        if (buf == NULL) {
+            qsort(row, rowlen, width * sizeof(int), cmp);
+            return;
+        }
+        radix_sort_row(row, rowlen, width, buf);
+        if (width == 1)
+            return;
+    }
+    insertion_sort_row(row, rowlen, width, cmp);
+}
+
+/* Get a buffer for sort_row, or NULL if no row needs one (or we failed to
+ * get one, in which case sort_row falls back to qsort). */
+static int *
+sort_buffer_alloc(gx_device *pdev, const int *table, const int *index,
+                  int scanlines, int width)
+{
+    int i, maxlen = 0;
+
+    for (i = 0; i < scanlines; i++)
+        if (table[index[i]] > maxlen)
+            maxlen = table[index[i]];
+    if (maxlen <= SORT_INSERTION_MAX)
+        return NULL;
+    return (int *)gs_alloc_byte_array(pdev->memory, maxlen, width * sizeof(int),
+                                      "scanc sort buffer");
+}
+
+/* Count the rows, starting with row i, of a filtered edgebuffer that fill
+ * the same pixels as row i does, so that they can be filled together.
+ * left_round and right_round are added to the ends of the spans before
+ * they are truncated to pixels. Runs stop at the end of a band, for the
+ * devices that need fills kept within max_fill_band lines. */
+static int
+edgebuffer_same_rows(gx_device *pdev, const gx_edgebuffer *edgebuffer,
+                     int i, fixed left_round, fixed right_round)
+{
+    const int *row = &edgebuffer->table[edgebuffer->index[i]];
+    int rowlen = row[0];
+    int mfb = pdev->max_fill_band;
+    int end = edgebuffer->height;
+    int n, k;
+
+    if (rowlen == 0)
+        return 1;
+    if (mfb) {
+        int y_band_max = ((edgebuffer->base + i) & ~(mfb-1)) + mfb - edgebuffer->base;
+        if (end > y_band_max)
+            end = y_band_max;
+    }
+    for (n = i+1; n < end; n++) {
+        const int *row2 = &edgebuffer->table[edgebuffer->index[n]];
+
+        if (row2[0] != rowlen)
+            break;
+        for (k = 1; k < rowlen; k += 2) {
+            if (fixed2int(row[k] + left_round) != fixed2int(row2[k] + left_round) ||
+                fixed2int(row[k+1] + right_round) != fixed2int(row2[k+1] + right_round))
+                break;
+        }
+        if (k < rowlen)
+            break;
+    }
+    return n - i;
+}
+
 /* Centre of a pixel routines */
 
 static int intcmp(const void *a, const void *b)
@@ -868,6 +1017,7 @@ int gx_scan_convert(gx_device     * gs_restrict pdev,
     const subpath *psub;
     int           *index;
     int           *table;
+    int           *sortbuf;
     int            i;
     int            code;
     int            zero;
@@ -960,11 +1110,12 @@ int gx_scan_convert(gx_device     * gs_restrict pdev,
 #endif
 
     /* Step 3: Sort the intersects on x */
+    sortbuf = sort_buffer_alloc(pdev, table, index, scanlines, 1);
     for (i=0; i < scanlines; i++) {
         int *row = &table[index[i]];
         int  rowlen = *row++;
 
-        /* Bubblesort short runs, qsort longer ones. */
+        /* Bubblesort short runs, sort_row longer ones. */
         /* FIXME: Check "6" below */
         if (rowlen <= 6) {
             int j, k;
@@ -977,8 +1128,9 @@ int gx_scan_convert(gx_device     * gs_restrict pdev,
                 }
             }
         } else
-            qsort(row, rowlen, sizeof(int), intcmp);
+            sort_row(row, rowlen, 1, sortbuf, intcmp);
     }
+    gs_free_object(pdev->memory, sortbuf, "scanc sort buffer");
 
     return 0;
 }
@@ -1046,12 +1198,13 @@ gx_fill_edgebuffer(gx_device       * gs_restrict pdev,
                    gx_edgebuffer   * gs_restrict edgebuffer,
                    int                        log_op)
 {
-    int i, code;
+    int i, h, code;
 
-    for (i=0; i < edgebuffer->height; i++) {
+    for (i=0; i < edgebuffer->height; i += h) {
         int *row    = &edgebuffer->table[edgebuffer->index[i]];
         int  rowlen = *row++;
 
+        h = edgebuffer_same_rows(pdev, edgebuffer, i, fixed_half, fixed_half);
         while (rowlen > 0) {
             int left, right;
 
@@ -1071,9 +1224,9 @@ gx_fill_edgebuffer(gx_device       * gs_restrict pdev,
                 dlprintf("closepath stroke %%PS\n");
 #endif
                 if (log_op < 0)
-                    code = dev_proc(pdev, fill_rectangle)(pdev, left, edgebuffer->base+i, right, 1, pdevc->colors.pure);
+                    code = dev_proc(pdev, fill_rectangle)(pdev, left, edgebuffer->base+i, right, h, pdevc->colors.pure);
                 else
-                    code = gx_fill_rectangle_device_rop(left, edgebuffer->base+i, right, 1, pdevc, pdev, (gs_logical_operation_t)log_op);
+                    code = gx_fill_rectangle_device_rop(left, edgebuffer->base+i, right, h, pdevc, pdev, (gs_logical_operation_t)log_op);
                 if (code < 0)
                     return code;
             }
@@ -2078,6 +2231,7 @@ int gx_scan_convert_app(gx_device     * gs_restrict pdev,
     const subpath *psub;
     int           *index;
     int           *table;
+    int           *sortbuf;
     int            i;
     cursor         cr;
     int            code;
@@ -2186,11 +2340,12 @@ int gx_scan_convert_app(gx_device     * gs_restrict pdev,
 #endif
 
     /* Step 3: Sort the intersects on x */
+    sortbuf = sort_buffer_alloc(pdev, table, index, scanlines, 2);
     for (i=0; i < scanlines; i++) {
         int *row = &table[index[i]];
         int  rowlen = *row++;
 
-        /* Bubblesort short runs, qsort longer ones. */
+        /* Bubblesort short runs, sort_row longer ones. */
         /* FIXME: Verify the figure 6 below */
         if (rowlen <= 6) {
             int j, k;
@@ -2213,8 +2368,9 @@ swap01:
                 }
             }
         } else
-            qsort(row, rowlen, 2*sizeof(int), edgecmp);
+            sort_row(row, rowlen, 2, sortbuf, edgecmp);
     }
+    gs_free_object(pdev->memory, sortbuf, "scanc sort buffer");
 
     return 0;
 }
@@ -2311,13 +2467,14 @@ gx_fill_edgebuffer_app(gx_device       * gs_restrict pdev,
                        gx_edgebuffer   * gs_restrict edgebuffer,
                        int                        log_op)
 {
-    int i, code;
+    int i, h, code;
 
-    for (i=0; i < edgebuffer->height; i++) {
+    for (i=0; i < edgebuffer->height; i += h) {
         int *row    = &edgebuffer->table[edgebuffer->index[i]];
         int  rowlen = *row++;
         int  left, right;
 
+        h = edgebuffer_same_rows(pdev, edgebuffer, i, 0, fixed_1 - 1);
         while (rowlen > 0) {
             left  = *row++;
             right = *row++;
@@ -2328,9 +2485,9 @@ gx_fill_edgebuffer_app(gx_device       * gs_restrict pdev,
             right -= left;
             if (right > 0) {
                 if (log_op < 0)
-                    code = dev_proc(pdev, fill_rectangle)(pdev, left, edgebuffer->base+i, right, 1, pdevc->colors.pure);
+                    code = dev_proc(pdev, fill_rectangle)(pdev, left, edgebuffer->base+i, right, h, pdevc->colors.pure);
                 else
-                    code = gx_fill_rectangle_device_rop(left, edgebuffer->base+i, right, 1, pdevc, pdev, (gs_logical_operation_t)log_op);
+                    code = gx_fill_rectangle_device_rop(left, edgebuffer->base+i, right, h, pdevc, pdev, (gs_logical_operation_t)log_op);
                 if (code < 0)
                     return code;
             }
@@ -2606,6 +2763,7 @@ int gx_scan_convert_tr(gx_device     * gs_restrict pdev,
     const subpath *psub;
     int           *index;
     int           *table;
+    int           *sortbuf;
     int            i;
     int            code;
     int            id = 0;
@@ -2710,11 +2868,12 @@ int gx_scan_convert_tr(gx_device     * gs_restrict pdev,
 #endif
 
     /* Step 4: Sort the intersects on x */
+    sortbuf = sort_buffer_alloc(pdev, table, index, scanlines, 2);
     for (i=0; i < scanlines; i++) {
         int *row = &table[index[i]];
         int  rowlen = *row++;
 
-        /* Bubblesort short runs, qsort longer ones. */
+        /* Bubblesort short runs, sort_row longer ones. */
         /* FIXME: Verify the figure 6 below */
         if (rowlen <= 6) {
             int j, k;
@@ -2734,8 +2893,9 @@ int gx_scan_convert_tr(gx_device     * gs_restrict pdev,
                 }
             }
         } else
-            qsort(row, rowlen, 2*sizeof(int), intcmp_tr);
+            sort_row(row, rowlen, 2, sortbuf, intcmp_tr);
     }
+    gs_free_object(pdev->memory, sortbuf, "scanc sort buffer");
 
     return 0;
 }
@@ -4062,6 +4222,7 @@ int gx_scan_convert_tr_app(gx_device     * gs_restrict pdev,
     const subpath *psub;
     int           *index;
     int           *table;
+    int           *sortbuf;
     int            i;
     cursor_tr      cr;
     int            code;
@@ -4172,11 +4333,12 @@ int gx_scan_convert_tr_app(gx_device     * gs_restrict pdev,
 #endif
 
     /* Step 3: Sort the intersects on x */
+    sortbuf = sort_buffer_alloc(pdev, table, index, scanlines, 4);
     for (i=0; i < scanlines; i++) {
         int *row = &table[index[i]];
         int  rowlen = *row++;
 
-        /* Bubblesort short runs, qsort longer ones. */
+        /* Bubblesort short runs, sort_row longer ones. */
         /* Figure of '6' comes from testing */
         if (rowlen <= 6) {
             int j, k;
@@ -4211,8 +4373,9 @@ swap13:
                 }
             }
         } else
-            qsort(row, rowlen, 4*sizeof(int), edgecmp_tr);
+            sort_row(row, rowlen, 4, sortbuf, edgecmp_tr);
     }
+    gs_free_object(pdev->memory, sortbuf, "scanc sort buffer");
 
     return 0;
 }
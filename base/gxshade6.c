@@ -37,6 +37,11 @@
 #include "math_.h"
 #include "gsicc_cache.h"
 #include "gxdevsop.h"
+#include "gzcpath.h"
+#include "gxdevmem.h"
+#include "gsfunc3.h"
+#include "gsfunc4.h"
+#include "gpsync.h"
 
 /* The original version of the shading code 'decompose's shadings into
  * smaller and smaller regions until they are smaller than 1 pixel, and then
@@ -402,6 +407,16 @@ curve_eval(gs_fixed_point * pt, const gs_fixed_point * p0,
               fixed2float(pt->y));
 }
 
+/* ---------------- Threaded patch filling ---------------- */
+
+typedef void (*patch_transform_proc_t)(gs_fixed_point *, const patch_curve_t[4],
+                                       const gs_fixed_point[4], double, double);
+
+static int patch_fill_threads(const patch_fill_state_t *pfs);
+static int patch_fill_in_strips(patch_fill_state_t *pfs, shade_coord_stream_t *cs,
+                                int BitsPerFlag, bool tensor,
+                                patch_transform_proc_t transform, int nthreads);
+
 /* ---------------- Coons patch shading ---------------- */
 
 /* Calculate the device-space coordinate corresponding to (u,v). */
@@ -447,7 +462,7 @@ gs_shading_Cp_fill_rectangle(const gs_shading_t * psh0, const gs_rect * rect,
     patch_fill_state_t state;
     shade_coord_stream_t cs;
     patch_curve_t curve[4];
-    int code;
+    int code, nthreads;
 
     code = mesh_init_fill_state((mesh_fill_state_t *) &state,
                          (const gs_shading_mesh_t *)psh0, rect_clip, dev, pgs);
@@ -464,11 +479,17 @@ gs_shading_Cp_fill_rectangle(const gs_shading_t * psh0, const gs_rect * rect,
 
     curve[0].straight = curve[1].straight = curve[2].straight = curve[3].straight = false;
     shade_next_init(&cs, (const gs_shading_mesh_params_t *)&psh->params, pgs);
-    while ((code = shade_next_patch(&cs, psh->params.BitsPerFlag,
-                                    curve, NULL)) == 0 &&
-           (code = patch_fill(&state, curve, NULL, Cp_transform)) >= 0
-        ) {
-        DO_NOTHING;
+    nthreads = patch_fill_threads(&state);
+    if (nthreads > 1)
+        code = patch_fill_in_strips(&state, &cs, psh->params.BitsPerFlag,
+                                    false, Cp_transform, nthreads);
+    else {
+        while ((code = shade_next_patch(&cs, psh->params.BitsPerFlag,
+                                        curve, NULL)) == 0 &&
+               (code = patch_fill(&state, curve, NULL, Cp_transform)) >= 0
+            ) {
+            DO_NOTHING;
+        }
     }
     if (term_patch_fill_state(&state))
         return_error(gs_error_unregistered); /* Must not happen. */
@@ -537,7 +558,7 @@ gs_shading_Tpp_fill_rectangle(const gs_shading_t * psh0, const gs_rect * rect,
     shade_coord_stream_t cs;
     patch_curve_t curve[4];
     gs_fixed_point interior[4];
-    int code;
+    int code, nthreads;
 
     code = mesh_init_fill_state((mesh_fill_state_t *) & state,
                          (const gs_shading_mesh_t *)psh0, rect_clip, dev, pgs);
@@ -551,21 +572,27 @@ gs_shading_Tpp_fill_rectangle(const gs_shading_t * psh0, const gs_rect * rect,
         return code;
     curve[0].straight = curve[1].straight = curve[2].straight = curve[3].straight = false;
     shade_next_init(&cs, (const gs_shading_mesh_params_t *)&psh->params, pgs);
-    while ((code = shade_next_patch(&cs, psh->params.BitsPerFlag,
-                                    curve, interior)) == 0) {
-        /*
-         * The order of points appears to be consistent with that for Coons
-         * patches, which is different from that documented in Red Book 3.
-         */
-        gs_fixed_point swapped_interior[4];
+    nthreads = patch_fill_threads(&state);
+    if (nthreads > 1)
+        code = patch_fill_in_strips(&state, &cs, psh->params.BitsPerFlag,
+                                    true, Tpp_transform, nthreads);
+    else {
+        while ((code = shade_next_patch(&cs, psh->params.BitsPerFlag,
+                                        curve, interior)) == 0) {
+            /*
+             * The order of points appears to be consistent with that for Coons
+             * patches, which is different from that documented in Red Book 3.
+             */
+            gs_fixed_point swapped_interior[4];
 
-        swapped_interior[0] = interior[0];
-        swapped_interior[1] = interior[3];
-        swapped_interior[2] = interior[2];
-        swapped_interior[3] = interior[1];
-        code = patch_fill(&state, curve, swapped_interior, Tpp_transform);
-        if (code < 0)
-            break;
+            swapped_interior[0] = interior[0];
+            swapped_interior[1] = interior[3];
+            swapped_interior[2] = interior[2];
+            swapped_interior[3] = interior[1];
+            code = patch_fill(&state, curve, swapped_interior, Tpp_transform);
+            if (code < 0)
+                break;
+        }
     }
     if (term_patch_fill_state(&state))
         return_error(gs_error_unregistered); /* Must not happen. */
@@ -4242,3 +4269,329 @@ out:
     release_colors_inline(pfs, color_stack_ptr, 4);
     return code;
 }
+
+/* ---------------- Threaded patch filling ---------------- */
+
+/*
+ * A big patch mesh may be filled by several threads. The clipping box is
+ * split into horizontal strips, one per thread, and each thread fills all
+ * the patches of the mesh, in their order, into its own strip. The bounding
+ * box tests in the decomposition throw away the parts of a patch outside
+ * the strip early, so each thread mostly decomposes its own share of the
+ * mesh. Every pixel is painted by one thread only, with the patches that
+ * cover it in mesh order, so the result doesn't depend on the timing of
+ * the threads.
+ *
+ * The threads share the color space and the Function, and write to the
+ * target device. We only do this where that is safe: the target is a memory
+ * device (possibly behind a clipper), the colors are linear and not
+ * halftoned, the color space is ICC based and the Function has no hidden
+ * state. Each worker thread has its own (shallow) copy of the gstate, with
+ * its own ICC link cache and the thread safe allocator, as the band
+ * rendering threads do (see gxclthrd.c), since building a link allocates
+ * from the cache's and the gstate's memory. The link each worker needs is
+ * built in its cache before the thread starts.
+ *
+ * The number of threads is given by the device's NumRenderingThreads
+ * parameter, so it applies to page mode rendering; with a command list the
+ * patches are decomposed while writing the list, and the band threads then
+ * only fill the trapezoids. Free form and lattice form triangle meshes
+ * (types 4 and 5) are always filled serially.
+ */
+
+#define PATCH_FILL_MIN_STRIP_HEIGHT 32
+
+typedef struct patch_fill_record_s {
+    patch_curve_t curve[4];
+    gs_fixed_point interior[4];
+} patch_fill_record_t;
+
+typedef struct patch_fill_strip_s {
+    patch_fill_state_t state;
+    gs_gstate pgs;              /* Private copy for a worker thread. */
+    gx_device_clip clipper;     /* Private copy of the caller's clipper. */
+    gx_device_clip strip;       /* Clips to the rows of the strip. */
+    gx_clip_path cpath;
+    const patch_fill_record_t *patches;
+    int num_patches;
+    bool tensor;
+    patch_transform_proc_t transform;
+    gp_thread_id thread;
+    int code;
+} patch_fill_strip_t;
+
+/* Check whether a Function may be evaluated by several threads at once. */
+static bool
+function_is_reentrant(const gs_function_t *pfn)
+{
+    gs_function_info_t info;
+    int i;
+
+    switch (pfn->head.type) {
+        case function_type_ExponentialInterpolation:
+        case function_type_1InputStitching:
+        case function_type_ArrayedOutput:
+        case function_type_PostScript_Calculator:
+            break;
+        default:
+            /* Sampled functions may read their samples from a stream. */
+            return false;
+    }
+    gs_function_get_info(pfn, &info);
+    if (info.Functions == NULL)
+        return true;
+    for (i = 0; i < info.num_Functions; i++)
+        if (!function_is_reentrant(info.Functions[i]))
+            return false;
+    return true;
+}
+
+/* Return the number of threads to fill a patch mesh with, 1 if serially. */
+static int
+patch_fill_threads(const patch_fill_state_t *pfs)
+{
+    gx_device *dev = pfs->dev, *tdev = dev;
+    char data[] = "NumRenderingThreads";
+    dev_param_req_t request;
+    gs_c_param_list list;
+    int nthreads = 0, max_threads;
+    int code;
+
+    if (pfs->pcic == NULL || pfs->trans_device != dev ||
+        gs_color_space_get_index(pfs->direct_space) != gs_color_space_index_ICC)
+        return 1;
+    if (pfs->Function != NULL && !function_is_reentrant(pfs->Function))
+        return 1;
+    if (gx_device_is_clip(dev)) {
+        if (((gx_device_clip *)dev)->cpath == NULL)
+            return 1;
+        tdev = ((gx_device_clip *)dev)->target;
+    }
+    if (!gs_device_is_memory(tdev) || gs_device_is_abuf(tdev))
+        return 1;
+    max_threads = (fixed2int_ceiling(pfs->rect.q.y) - fixed2int(pfs->rect.p.y)) /
+                    PATCH_FILL_MIN_STRIP_HEIGHT;
+    if (max_threads < 2)
+        return 1;
+
+    gs_c_param_list_write(&list, dev->memory);
+    request.Param = data;
+    request.list = &list;
+    code = dev_proc(dev, dev_spec_op)(dev, gxdso_get_dev_param, &request, sizeof(dev_param_req_t));
+    if (code < 0 && code != gs_error_undefined) {
+        gs_c_param_list_release(&list);
+        return 1;
+    }
+    gs_c_param_list_read(&list);
+    code = param_read_int((gs_param_list *)&list, "NumRenderingThreads", &nthreads);
+    gs_c_param_list_release(&list);
+    if (code != 0 || nthreads < 2)
+        return 1;
+    return min(nthreads, max_threads);
+}
+
+static void
+patch_fill_strip(void *arg)
+{
+    patch_fill_strip_t *s = (patch_fill_strip_t *)arg;
+    int i, code = 0;
+
+    for (i = 0; i < s->num_patches && code >= 0; i++)
+        code = patch_fill(&s->state, s->patches[i].curve,
+                          (s->tensor ? s->patches[i].interior : NULL), s->transform);
+    s->code = code;
+}
+
+static int
+patch_fill_records(patch_fill_state_t *pfs, const patch_fill_record_t *patches,
+                   int num_patches, bool tensor, patch_transform_proc_t transform)
+{
+    int i, code = 0;
+
+    for (i = 0; i < num_patches && code >= 0; i++)
+        code = patch_fill(pfs, patches[i].curve,
+                          (tensor ? patches[i].interior : NULL), transform);
+    return code;
+}
+
+/* Fill the patches, split into nthreads strips. */
+static int
+patch_fill_strips(patch_fill_state_t *pfs, const patch_fill_record_t *patches,
+                  int num_patches, bool tensor, patch_transform_proc_t transform,
+                  int nthreads)
+{
+    gs_memory_t *mem = pfs->pgs->memory;
+    gx_device *dev = pfs->dev;
+    int y0 = fixed2int(pfs->rect.p.y), y1 = fixed2int_ceiling(pfs->rect.q.y);
+    patch_fill_strip_t *strips;
+    int i, code = 0;
+
+    strips = (patch_fill_strip_t *)gs_alloc_byte_array(mem->non_gc_memory, nthreads,
+                                    sizeof(patch_fill_strip_t), "patch_fill_strips");
+    if (strips == NULL)
+        return patch_fill_records(pfs, patches, num_patches, tensor, transform);
+    memset(strips, 0, nthreads * sizeof(patch_fill_strip_t));
+    for (i = 0; i < nthreads; i++)
+        gx_cpath_init_local(&strips[i].cpath, mem);
+
+    for (i = 0; i < nthreads && code >= 0; i++) {
+        patch_fill_strip_t *s = &strips[i];
+        int sy0 = y0 + (int)((int64_t)(y1 - y0) * i / nthreads);
+        int sy1 = y0 + (int)((int64_t)(y1 - y0) * (i + 1) / nthreads);
+        gs_fixed_rect rect = pfs->rect, clip;
+        gx_device *tdev = dev;
+        gs_gstate *pgs = pfs->pgs;
+
+        /* The decomposition is limited to the strip, but the trapezoids
+           are rounded outwards, so the strip is clipped as well. */
+        if (i > 0)
+            rect.p.y = int2fixed(sy0);
+        if (i < nthreads - 1)
+            rect.q.y = int2fixed(sy1);
+        clip.p.x = int2fixed(min(fixed2int(rect.p.x), 0));
+        clip.q.x = int2fixed(max(fixed2int_ceiling(rect.q.x), dev->width));
+        clip.p.y = int2fixed(i == 0 ? min(sy0, 0) : sy0);
+        clip.q.y = int2fixed(i == nthreads - 1 ? max(sy1, dev->height) : sy1);
+        code = gx_cpath_from_rectangle(&s->cpath, &clip);
+        if (code < 0)
+            break;
+        if (gx_device_is_clip(dev)) {
+            gx_device_clip *cdev = (gx_device_clip *)dev;
+
+            gx_make_clip_device_on_stack(&s->clipper, cdev->cpath, cdev->target);
+            s->clipper.translation = cdev->translation;
+            tdev = (gx_device *)&s->clipper;
+        }
+        gx_make_clip_device_on_stack(&s->strip, &s->cpath, tdev);
+        if (i > 0) {
+            /* Nothing is reference counted or freed through the copy,
+               other than its own link cache. */
+            s->pgs = *pfs->pgs;
+            s->pgs.memory = mem->thread_safe_memory;
+            s->pgs.icc_link_cache = gsicc_cache_new(mem->thread_safe_memory);
+            if (s->pgs.icc_link_cache == NULL) {
+                code = gs_note_error(gs_error_VMerror);
+                break;
+            }
+            pgs = &s->pgs;
+        }
+        code = mesh_init_fill_state((mesh_fill_state_t *)&s->state, pfs->pshm,
+                                    &rect, (gx_device *)&s->strip, pgs);
+        if (code < 0)
+            break;
+        s->state.Function = pfs->Function;
+        code = init_patch_fill_state(&s->state);
+        if (code < 0)
+            break;
+        if (i > 0) {
+            /* Convert a color, so that the link the color conversions
+               will use is built here rather than on the thread. */
+            patch_color_t *c;
+            byte *color_stack_ptr = reserve_colors(&s->state, &c, 1);
+            gx_device_color devc;
+
+            patch_set_color(&s->state, c, patches[0].curve[0].vertex.cc);
+            patch_resolve_color(c, &s->state);
+            code = patch_color_to_device_color(&s->state, c, &devc);
+            release_colors(&s->state, color_stack_ptr, 1);
+            if (code < 0)
+                break;
+        }
+        s->patches = patches;
+        s->num_patches = num_patches;
+        s->tensor = tensor;
+        s->transform = transform;
+    }
+    if (code >= 0) {
+        for (i = 1; i < nthreads; i++) {
+            if (gp_thread_start(patch_fill_strip, &strips[i], &strips[i].thread) < 0)
+                strips[i].thread = NULL;
+        }
+        patch_fill_strip(&strips[0]);
+        for (i = 1; i < nthreads; i++) {
+            if (strips[i].thread != NULL)
+                gp_thread_finish(strips[i].thread);
+            else
+                patch_fill_strip(&strips[i]);
+        }
+        for (i = 0; i < nthreads && code >= 0; i++)
+            code = strips[i].code;
+    } else {
+        /* Couldn't set up the strips, so fill serially. */
+        code = patch_fill_records(pfs, patches, num_patches, tensor, transform);
+    }
+    for (i = 0; i < nthreads; i++) {
+        patch_fill_strip_t *s = &strips[i];
+
+        if (s->state.memory != NULL && term_patch_fill_state(&s->state) && code >= 0)
+            code = gs_note_error(gs_error_unregistered); /* Must not happen. */
+        if (s->state.icclink != NULL)
+            gsicc_release_link(s->state.icclink);
+        if (s->pgs.icc_link_cache != NULL)
+            rc_decrement(s->pgs.icc_link_cache, "patch_fill_strips");
+        gx_cpath_free(&s->cpath, "patch_fill_strips");
+    }
+    gs_free_object(mem->non_gc_memory, strips, "patch_fill_strips");
+    return code;
+}
+
+/*
+ * Read the whole mesh, then fill it in strips. If we can't keep the whole
+ * mesh in memory, fill what we have read and carry on serially.
+ */
+static int
+patch_fill_in_strips(patch_fill_state_t *pfs, shade_coord_stream_t *cs,
+                     int BitsPerFlag, bool tensor,
+                     patch_transform_proc_t transform, int nthreads)
+{
+    gs_memory_t *mem = pfs->pgs->memory->non_gc_memory;
+    patch_curve_t curve[4];
+    gs_fixed_point interior[4];
+    patch_fill_record_t *patches = NULL, *p;
+    int num_patches = 0, max_patches = 0;
+    bool serial = false;
+    int code, fill_code = 0;
+
+    curve[0].straight = curve[1].straight = curve[2].straight = curve[3].straight = false;
+    while ((code = shade_next_patch(cs, BitsPerFlag, curve,
+                                    (tensor ? interior : NULL))) == 0) {
+        if (!serial && num_patches == max_patches) {
+            int n = max(max_patches * 2, 64);
+
+            p = (patch_fill_record_t *)gs_alloc_byte_array(mem, n, sizeof(*p),
+                                                            "patch_fill_in_strips");
+            if (p == NULL) {
+                fill_code = patch_fill_records(pfs, patches, num_patches, tensor, transform);
+                num_patches = 0;
+                serial = true;
+            } else if (patches != NULL)
+                memcpy(p, patches, num_patches * sizeof(*p));
+            gs_free_object(mem, patches, "patch_fill_in_strips");
+            patches = p;
+            max_patches = n;
+        }
+        p = (serial ? NULL : &patches[num_patches++]);
+        if (p != NULL)
+            memcpy(p->curve, curve, sizeof(curve));
+        if (tensor) {
+            /* The order of points as in gs_shading_Tpp_fill_rectangle. */
+            gs_fixed_point swapped_interior[4];
+
+            swapped_interior[0] = interior[0];
+            swapped_interior[1] = interior[3];
+            swapped_interior[2] = interior[2];
+            swapped_interior[3] = interior[1];
+            if (p != NULL)
+                memcpy(p->interior, swapped_interior, sizeof(swapped_interior));
+            else if (fill_code >= 0)
+                fill_code = patch_fill(pfs, curve, swapped_interior, transform);
+        } else if (p == NULL && fill_code >= 0)
+            fill_code = patch_fill(pfs, curve, NULL, transform);
+        if (fill_code < 0)
+            break;
+    }
+    if (num_patches > 0 && fill_code >= 0)
+        fill_code = patch_fill_strips(pfs, patches, num_patches, tensor, transform, nthreads);
+    gs_free_object(mem, patches, "patch_fill_in_strips");
+    return (fill_code < 0 ? fill_code : code);
+}
@@ -23,6 +23,16 @@
 #include "strimpl.h"
 #include "siscale.h"
 #include "gxfrac.h"
+#ifdef HAVE_SSE2
+#include <emmintrin.h>
+#endif
+
+/* Define this to time the SSE2 zooms against the scalar ones */
+#undef BENCH_ISCALE
+
+#ifdef BENCH_ISCALE
+#include "gp.h"
+#endif
 
 /*
  *    Image scaling code is based on public domain code from
@@ -846,6 +856,285 @@ zoom_y2_frac(void /*PixelOut */ * gs_restrict dst,
             break;
     }
 }
+#ifdef HAVE_SSE2
+/* SSE2 versions of the zooms. These do exactly the integer sums of the
+ * scalar ones, and so give the same results.
+ *
+ * The horizontal zooms (8 bit 4 components, 16 bit 3 or 4 components) work
+ * a pixel at a time, taking the contributing pixels in pairs with
+ * _mm_madd_epi16, so they need every weight to fit in 16 bits; choose_zooms
+ * checks for that.
+ *
+ * The vertical zooms work on 8 samples of a row at a time, whatever the
+ * number of components. If the row's weights fit in 16 bits they too use
+ * _mm_madd_epi16 on pairs of rows, otherwise (16 bit output) each weight
+ * is split into 16 bit halves. */
+
+/* Is every weight in use small enough for _mm_madd_epi16? */
+static bool
+contrib_fits_16(const CLIST *contrib, const CONTRIB *items, int size)
+{
+    int i, j;
+
+    for (i = 0; i < size; i++) {
+        const CONTRIB *cp = items + contrib[i].index;
+
+        for (j = 0; j < contrib[i].n; j++)
+            if (cp[j].weight < -32768 || cp[j].weight > 32767)
+                return false;
+    }
+    return true;
+}
+
+/* Two 16 bit weights for _mm_madd_epi16 */
+#define WEIGHT_PAIR(w0, w1)\
+  _mm_set1_epi32((int)(((uint)(w0) & 0xffff) | ((uint)(w1) << 16)))
+
+static void
+zoom_x1_4_sse2(byte * gs_restrict tmp, const void /*PixelIn */ * gs_restrict src,
+               int skip, int tmp_width, int Colors, const CLIST * gs_restrict contrib,
+               const CONTRIB * gs_restrict items)
+{
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i round = _mm_set1_epi32(CONTRIB_ROUND);
+
+    contrib += skip;
+    tmp += 4 * skip;
+
+    for ( ; tmp_width != 0; --tmp_width ) {
+        int j = contrib->n;
+        const byte *gs_restrict pp = ((const byte *)src) + contrib->first_pixel;
+        const CONTRIB *gs_restrict cp = items + (contrib++)->index;
+        __m128i acc = zero, a, b;
+        int v;
+
+        for ( ; j > 1; j -= 2, pp += 8, cp += 2 ) {
+            a = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i *)pp), zero);
+            b = _mm_srli_si128(a, 8);
+            acc = _mm_add_epi32(acc, _mm_madd_epi16(_mm_unpacklo_epi16(a, b),
+                                                    WEIGHT_PAIR(cp[0].weight, cp[1].weight)));
+        }
+        if (j) {
+            memcpy(&v, pp, 4);
+            a = _mm_unpacklo_epi8(_mm_cvtsi32_si128(v), zero);
+            acc = _mm_add_epi32(acc, _mm_madd_epi16(_mm_unpacklo_epi16(a, zero),
+                                                    WEIGHT_PAIR(cp[0].weight, 0)));
+        }
+        acc = _mm_srai_epi32(_mm_add_epi32(acc, round), CONTRIB_SHIFT);
+        acc = _mm_packs_epi32(acc, acc);
+        v = _mm_cvtsi128_si32(_mm_packus_epi16(acc, acc));
+        memcpy(tmp, &v, 4);
+        tmp += 4;
+    }
+}
+
+/* 16 bit samples are offset by 0x8000 to make them signed for
+ * _mm_madd_epi16, and the offset times the sum of the weights is added
+ * back at the end. */
+static inline void
+zoom_x2_n_sse2(byte * gs_restrict tmp, const void /*PixelIn */ * gs_restrict src,
+               int skip, int tmp_width, const CLIST * gs_restrict contrib,
+               const CONTRIB * gs_restrict items, const int Colors)
+{
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i bias = _mm_set1_epi16((short)0x8000);
+
+    contrib += skip;
+    tmp += Colors * skip;
+
+    for ( ; tmp_width != 0; --tmp_width ) {
+        int j = contrib->n;
+        const bits16 *gs_restrict pp = ((const bits16 *)src) + contrib->first_pixel;
+        const CONTRIB *gs_restrict cp = items + (contrib++)->index;
+        __m128i acc = zero, a, b;
+        int wsum = 0, out;
+
+        for ( ; j > 1; j -= 2, pp += 2 * Colors, cp += 2 ) {
+            if (Colors == 4) {
+                a = _mm_xor_si128(_mm_loadu_si128((const __m128i *)pp), bias);
+                b = _mm_srli_si128(a, 8);
+            } else {
+                /* b is loaded from the last sample of a and shifted
+                 * down, so as not to read past the pair. */
+                a = _mm_xor_si128(_mm_loadl_epi64((const __m128i *)pp), bias);
+                b = _mm_xor_si128(_mm_srli_epi64(_mm_loadl_epi64((const __m128i *)(pp + 2)), 16),
+                                  bias);
+            }
+            acc = _mm_add_epi32(acc, _mm_madd_epi16(_mm_unpacklo_epi16(a, b),
+                                                    WEIGHT_PAIR(cp[0].weight, cp[1].weight)));
+            wsum += cp[0].weight + cp[1].weight;
+        }
+        if (j) {
+            bits16 v[4];
+
+            memcpy(v, pp, Colors * sizeof(bits16));
+            a = _mm_xor_si128(_mm_loadl_epi64((const __m128i *)v), bias);
+            acc = _mm_add_epi32(acc, _mm_madd_epi16(_mm_unpacklo_epi16(a, zero),
+                                                    WEIGHT_PAIR(cp[0].weight, 0)));
+            wsum += cp[0].weight;
+        }
+        acc = _mm_add_epi32(acc, _mm_set1_epi32(wsum * 0x8000 + CONTRIB_ROUND));
+        acc = _mm_srai_epi32(acc, CONTRIB_SHIFT);
+        acc = _mm_packs_epi32(acc, acc);
+        out = _mm_cvtsi128_si32(_mm_packus_epi16(acc, acc));
+        if (Colors == 4) {
+            memcpy(tmp, &out, 4);
+            tmp += 4;
+        } else {
+            *tmp++ = (byte)out;
+            *tmp++ = (byte)(out >> 8);
+            *tmp++ = (byte)(out >> 16);
+        }
+    }
+}
+
+static void
+zoom_x2_3_sse2(byte * gs_restrict tmp, const void /*PixelIn */ * gs_restrict src,
+               int skip, int tmp_width, int Colors, const CLIST * gs_restrict contrib,
+               const CONTRIB * gs_restrict items)
+{
+    zoom_x2_n_sse2(tmp, src, skip, tmp_width, contrib, items, 3);
+}
+
+static void
+zoom_x2_4_sse2(byte * gs_restrict tmp, const void /*PixelIn */ * gs_restrict src,
+               int skip, int tmp_width, int Colors, const CLIST * gs_restrict contrib,
+               const CONTRIB * gs_restrict items)
+{
+    zoom_x2_n_sse2(tmp, src, skip, tmp_width, contrib, items, 4);
+}
+
+#define ZOOM_Y_SSE2_MAX 64
+
+static inline void
+zoom_y_sse2(void /*PixelOut */ * gs_restrict dst,
+            const byte * gs_restrict tmp, int skip, int WidthOut, int Stride,
+            int Colors, const CLIST * gs_restrict contrib, const CONTRIB * gs_restrict items,
+            const int sizeofPixelOut, const int maxval)
+{
+    int kn = Stride * Colors;
+    int width = WidthOut * Colors;
+    int cn = contrib->n;
+    const CONTRIB *gs_restrict cbp = items + contrib->index;
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i round = _mm_set1_epi32(CONTRIB_ROUND);
+    const __m128i vmax = _mm_set1_epi32(maxval);
+    const __m128i v8000 = _mm_set1_epi32(0x8000);
+    __m128i w[ZOOM_Y_SSE2_MAX];
+    bool fits_16 = true;
+    int x, j;
+
+    skip *= Colors;
+    tmp += contrib->first_pixel + skip;
+    for (j = 0; j < cn; j++)
+        if (cbp[j].weight < -32768 || cbp[j].weight > 32767)
+            fits_16 = false;
+    if (fits_16) {
+        for (j = 0; j < cn; j += 2)
+            w[j >> 1] = WEIGHT_PAIR(cbp[j].weight, j + 1 < cn ? cbp[j + 1].weight : 0);
+    } else {
+        /* Low and high halves of each weight */
+        for (j = 0; j < cn; j++) {
+            w[2 * j] = _mm_set1_epi16((short)(cbp[j].weight & 0xffff));
+            w[2 * j + 1] = _mm_set1_epi16((short)(cbp[j].weight >> 16));
+        }
+    }
+
+    for (x = 0; x + 8 <= width; x += 8) {
+        const byte *gs_restrict pp = tmp + x;
+        __m128i lo = zero, hi = zero, t0, t1;
+
+        if (fits_16) {
+            for (j = 0; j < cn; j += 2, pp += 2 * kn) {
+                t0 = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i *)pp), zero);
+                t1 = j + 1 < cn ?
+                    _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i *)(pp + kn)), zero) : zero;
+                lo = _mm_add_epi32(lo, _mm_madd_epi16(_mm_unpacklo_epi16(t0, t1), w[j >> 1]));
+                hi = _mm_add_epi32(hi, _mm_madd_epi16(_mm_unpackhi_epi16(t0, t1), w[j >> 1]));
+            }
+        } else {
+            /* t * w = t * (w & 0xffff) + ((t * (w >> 16)) << 16) modulo 2^32 */
+            for (j = 0; j < cn; j++, pp += kn) {
+                __m128i pl, ph, m;
+
+                t0 = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i *)pp), zero);
+                pl = _mm_mullo_epi16(t0, w[2 * j]);
+                ph = _mm_mulhi_epu16(t0, w[2 * j]);
+                m = _mm_mullo_epi16(t0, w[2 * j + 1]);
+                lo = _mm_add_epi32(lo, _mm_add_epi32(_mm_unpacklo_epi16(pl, ph),
+                                                     _mm_unpacklo_epi16(zero, m)));
+                hi = _mm_add_epi32(hi, _mm_add_epi32(_mm_unpackhi_epi16(pl, ph),
+                                                     _mm_unpackhi_epi16(zero, m)));
+            }
+        }
+        lo = _mm_srai_epi32(_mm_add_epi32(lo, round), CONTRIB_SHIFT);
+        hi = _mm_srai_epi32(_mm_add_epi32(hi, round), CONTRIB_SHIFT);
+        if (sizeofPixelOut == 1) {
+            lo = _mm_packs_epi32(lo, hi);
+            _mm_storel_epi64((__m128i *)((byte *)dst + skip + x), _mm_packus_epi16(lo, lo));
+        } else {
+            __m128i m;
+
+            /* Clamp to 0..maxval, then pack as signed around 0x8000 */
+            lo = _mm_andnot_si128(_mm_srai_epi32(lo, 31), lo);
+            hi = _mm_andnot_si128(_mm_srai_epi32(hi, 31), hi);
+            m = _mm_cmpgt_epi32(lo, vmax);
+            lo = _mm_or_si128(_mm_and_si128(m, vmax), _mm_andnot_si128(m, lo));
+            m = _mm_cmpgt_epi32(hi, vmax);
+            hi = _mm_or_si128(_mm_and_si128(m, vmax), _mm_andnot_si128(m, hi));
+            lo = _mm_packs_epi32(_mm_sub_epi32(lo, v8000), _mm_sub_epi32(hi, v8000));
+            _mm_storeu_si128((__m128i *)((bits16 *)dst + skip + x),
+                             _mm_xor_si128(lo, _mm_set1_epi16((short)0x8000)));
+        }
+    }
+    for (; x < width; x++) {
+        const byte *gs_restrict pp = tmp + x;
+        int weight = 0, pixel;
+
+        for (j = 0; j < cn; pp += kn, j++)
+            weight += *pp * cbp[j].weight;
+        pixel = (weight + CONTRIB_ROUND)>>CONTRIB_SHIFT;
+        if (sizeofPixelOut == 1)
+            ((byte *)dst)[skip + x] = (byte)CLAMP(pixel, 0, 0xff);
+        else
+            ((bits16 *)dst)[skip + x] = (bits16)CLAMP(pixel, 0, maxval);
+    }
+}
+
+static void
+zoom_y1_sse2(void /*PixelOut */ * gs_restrict dst,
+             const byte * gs_restrict tmp, int skip, int WidthOut, int Stride,
+             int Colors, const CLIST * gs_restrict contrib, const CONTRIB * gs_restrict items)
+{
+    if (contrib->n > ZOOM_Y_SSE2_MAX / 2)
+        zoom_y1(dst, tmp, skip, WidthOut, Stride, Colors, contrib, items);
+    else
+        zoom_y_sse2(dst, tmp, skip, WidthOut, Stride, Colors, contrib, items, 1, 0xff);
+}
+
+static void
+zoom_y2_sse2(void /*PixelOut */ * gs_restrict dst,
+             const byte * gs_restrict tmp, int skip, int WidthOut, int Stride,
+             int Colors, const CLIST * gs_restrict contrib, const CONTRIB * gs_restrict items)
+{
+    if (contrib->n > ZOOM_Y_SSE2_MAX / 2)
+        zoom_y2(dst, tmp, skip, WidthOut, Stride, Colors, contrib, items);
+    else
+        zoom_y_sse2(dst, tmp, skip, WidthOut, Stride, Colors, contrib, items, 2, 0xffff);
+}
+
+static void
+zoom_y2_frac_sse2(void /*PixelOut */ * gs_restrict dst,
+                  const byte * gs_restrict tmp, int skip, int WidthOut, int Stride,
+                  int Colors, const CLIST * gs_restrict contrib, const CONTRIB * gs_restrict items)
+{
+    if (contrib->n > ZOOM_Y_SSE2_MAX / 2)
+        zoom_y2_frac(dst, tmp, skip, WidthOut, Stride, Colors, contrib, items);
+    else
+        zoom_y_sse2(dst, tmp, skip, WidthOut, Stride, Colors, contrib, items, 2, frac_1);
+}
+#endif /* HAVE_SSE2 */
+
 /* ------ Stream implementation ------ */
 
 /* Forward references */
@@ -914,6 +1203,66 @@ typedef struct filter_defn_s {
     double  min_scale;
 } filter_defn_s;
 
+/* Select the horizontal and vertical zooms for the state's pixel format. */
+static void
+choose_zooms(stream_IScale_state *ss, int limited_WidthOut, bool use_sse2)
+{
+    if (ss->sizeofPixelIn == 2)
+        ss->zoom_x = zoom_x2;
+    else {
+        switch (ss->params.spp_interp) {
+            case 1:
+                ss->zoom_x = zoom_x1_1;
+                break;
+            case 3:
+                ss->zoom_x = zoom_x1_3;
+                break;
+            case 4:
+                ss->zoom_x = zoom_x1_4;
+                break;
+            default:
+                ss->zoom_x = zoom_x1;
+                break;
+        }
+    }
+
+    if (ss->sizeofPixelOut == 1)
+        ss->zoom_y = zoom_y1;
+    else if (ss->params.MaxValueOut == frac_1)
+        ss->zoom_y = zoom_y2_frac;
+    else
+        ss->zoom_y = zoom_y2;
+
+#ifdef HAVE_SSE2
+    if (!use_sse2)
+        return;
+    if (contrib_fits_16(ss->contrib, ss->items, limited_WidthOut)) {
+        /* The compiler does as well as SSE2 on the scalar 8 bit 1 and 3
+         * component zooms. */
+        if (ss->sizeofPixelIn == 1) {
+            if (ss->params.spp_interp == 4)
+                ss->zoom_x = zoom_x1_4_sse2;
+        } else {
+            if (ss->params.spp_interp == 3)
+                ss->zoom_x = zoom_x2_3_sse2;
+            else if (ss->params.spp_interp == 4)
+                ss->zoom_x = zoom_x2_4_sse2;
+        }
+    }
+    if (ss->zoom_y == zoom_y1)
+        ss->zoom_y = zoom_y1_sse2;
+    else if (ss->zoom_y == zoom_y2_frac)
+        ss->zoom_y = zoom_y2_frac_sse2;
+    else
+        ss->zoom_y = zoom_y2_sse2;
+#endif
+}
+
+#ifdef BENCH_ISCALE
+static int s_IScale_init(stream_state * st);
+static void bench_iscale(gs_memory_t *mem);
+#endif
+
 /* Initialize the filter. */
 static int
 do_init(stream_state        *st,
@@ -1001,31 +1350,17 @@ do_init(stream_state        *st,
     /* Prepare the weights for the first output row. */
     calculate_dst_contrib(ss, 0);
 
-    if (ss->sizeofPixelIn == 2)
-        ss->zoom_x = zoom_x2;
-    else {
-        switch (ss->params.spp_interp) {
-            case 1:
-                ss->zoom_x = zoom_x1_1;
-                break;
-            case 3:
-                ss->zoom_x = zoom_x1_3;
-                break;
-            case 4:
-                ss->zoom_x = zoom_x1_4;
-                break;
-            default:
-                ss->zoom_x = zoom_x1;
-                break;
+    choose_zooms(ss, limited_WidthOut, true);
+#ifdef BENCH_ISCALE
+    {
+        static bool bench_done = false;
+
+        if (!bench_done) {
+            bench_done = true;
+            bench_iscale(mem->non_gc_memory);
         }
     }
-
-    if (ss->sizeofPixelOut == 1)
-        ss->zoom_y = zoom_y1;
-    else if (ss->params.MaxValueOut == frac_1)
-        ss->zoom_y = zoom_y2_frac;
-    else
-        ss->zoom_y = zoom_y2;
+#endif
 
     return 0;
 }
@@ -1206,6 +1541,115 @@ s_IScale_release(stream_state * st)
     ss->tmp = 0;
 }
 
+#ifdef BENCH_ISCALE
+/* Time the SSE2 zooms against the scalar ones for some common scale
+ * ratios, on synthetic data, and check that both give the same results.
+ * This runs once, the first time a scaler is initialised, in builds with
+ * BENCH_ISCALE. */
+static long
+bench_iscale_since(const long t0[2])
+{
+    long t1[2];
+
+    gp_get_realtime(t1);
+    return (t1[0] - t0[0]) * 1000000 + (t1[1] - t0[1]) / 1000;
+}
+
+static void
+bench_iscale(gs_memory_t *mem)
+{
+    static const double ratios[] = { 0.5, 1.5, 2.0, 4.17 };
+    static const int spps[] = { 1, 3, 4 };
+    const int width_in = 1024, height_in = 64, reps = 50;
+    int r, c, bits, i, k;
+
+    for (bits = 8; bits <= 16; bits += 8)
+    for (c = 0; c < countof(spps); c++)
+    for (r = 0; r < countof(ratios); r++) {
+        stream_IScale_state *ss = (stream_IScale_state *)
+            gs_alloc_bytes(mem, sizeof(*ss), "bench_iscale");
+        int width_out = (int)(width_in * ratios[r]);
+        int height_out = (int)(height_in * ratios[r]);
+        int spp = spps[c];
+        int row_size, tmp_size, dst_size;
+        byte *tmp_a = NULL, *tmp_b = NULL, *dst_a = NULL, *dst_b = NULL;
+        zoom_x_fn *zoom_x_scalar;
+        zoom_y_fn *zoom_y_scalar;
+        long t0[2], tx[2], ty[2];
+        uint seed = 1;
+
+        if (ss == NULL)
+            return;
+        memset(ss, 0, sizeof(*ss));
+        ss->memory = mem;
+        ss->params.spp_decode = ss->params.spp_interp = spp;
+        ss->params.BitsPerComponentIn = ss->params.BitsPerComponentOut = bits;
+        ss->params.MaxValueIn = ss->params.MaxValueOut = (1 << bits) - 1;
+        ss->params.abs_interp_limit = 1;
+        ss->params.EntireWidthIn = ss->params.WidthIn = ss->params.PatchWidthIn = width_in;
+        ss->params.EntireHeightIn = ss->params.HeightIn = ss->params.PatchHeightIn = height_in;
+        ss->params.EntireWidthOut = ss->params.WidthOut = ss->params.PatchWidthOut = width_out;
+        ss->params.EntireHeightOut = ss->params.HeightOut = ss->params.PatchHeightOut = height_out;
+        if (s_IScale_init((stream_state *)ss) < 0) {
+            gs_free_object(mem, ss, "bench_iscale");
+            return;
+        }
+        /* A row in the middle of the image, away from the edges */
+        calculate_dst_contrib(ss, height_out / 2);
+
+        row_size = width_out * spp;
+        tmp_size = ss->max_support * row_size;
+        dst_size = row_size * ss->sizeofPixelOut;
+        tmp_a = gs_alloc_bytes(mem, tmp_size, "bench_iscale");
+        tmp_b = gs_alloc_bytes(mem, tmp_size, "bench_iscale");
+        dst_a = gs_alloc_bytes(mem, dst_size, "bench_iscale");
+        dst_b = gs_alloc_bytes(mem, dst_size, "bench_iscale");
+        if (tmp_a == NULL || tmp_b == NULL || dst_a == NULL || dst_b == NULL)
+            goto next;
+        for (i = 0; i < (int)ss->src_size; i++) {
+            seed = seed * 1103515245 + 12345;
+            ((byte *)ss->src)[i] = (byte)(seed >> 16);
+        }
+        for (i = 0; i < tmp_size; i++) {
+            seed = seed * 1103515245 + 12345;
+            tmp_a[i] = tmp_b[i] = (byte)(seed >> 16);
+        }
+
+        choose_zooms(ss, width_out, false);
+        zoom_x_scalar = ss->zoom_x;
+        zoom_y_scalar = ss->zoom_y;
+        choose_zooms(ss, width_out, true);
+
+        for (k = 0; k < 2; k++) {
+            zoom_x_fn *zx = k ? ss->zoom_x : zoom_x_scalar;
+            zoom_y_fn *zy = k ? ss->zoom_y : zoom_y_scalar;
+            byte *tmp = k ? tmp_b : tmp_a;
+            byte *dst = k ? dst_b : dst_a;
+
+            gp_get_realtime(t0);
+            for (i = 0; i < reps * 4; i++)
+                zx(tmp + (i % ss->max_support) * row_size, ss->src, 0, width_out, spp,
+                   ss->contrib, ss->items);
+            tx[k] = bench_iscale_since(t0);
+            gp_get_realtime(t0);
+            for (i = 0; i < reps * 4; i++)
+                zy(dst, tmp, 0, width_out, width_out, spp, &ss->dst_next_list, ss->dst_items);
+            ty[k] = bench_iscale_since(t0);
+        }
+        dmprintf8(mem, "iscale %2d bit %d spp x%-5.2f  zoom_x scalar %7ldus sse2 %7ldus  zoom_y scalar %7ldus sse2 %7ldus  %s\n",
+                  bits, spp, ratios[r], tx[0], tx[1], ty[0], ty[1],
+                  memcmp(tmp_a, tmp_b, tmp_size) || memcmp(dst_a, dst_b, dst_size) ? "MISMATCH" : "ok");
+    next:
+        gs_free_object(mem, tmp_a, "bench_iscale");
+        gs_free_object(mem, tmp_b, "bench_iscale");
+        gs_free_object(mem, dst_a, "bench_iscale");
+        gs_free_object(mem, dst_b, "bench_iscale");
+        s_IScale_release((stream_state *)ss);
+        gs_free_object(mem, ss, "bench_iscale");
+    }
+}
+#endif
+
 /* Stream template */
 const stream_template s_IScale_template = {
     &st_IScale_state, s_IScale_init, s_IScale_process, 1, 1,
@@ -289,7 +289,10 @@ const gx_device_bit gs_bitrgbtags_device =
         NULL,  /* file */
         false, /* bg_print_requested */
         0,     /* bg_print *  */
+        1,     /* bg_print_depth */
+        0,     /* bg_print_max_memory */
         0,     /* num_render_threads_requested */
+        false, /* adaptive_banding_requested */
         NULL,  /* saved_pages_list */
         {0}    /* save_procs_while_delaying_erasepage */
     };
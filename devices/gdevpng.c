@@ -467,20 +467,36 @@ my_png_flush(png_struct *png)
 
 /* Write out a page in PNG format. */
 /* This routine is used for all formats. */
+typedef struct png_write_row_arg_s {
+    png_struct *png_ptr;
+#ifdef CLUSTER
+    int end;
+    int mask;
+#endif
+} png_write_row_arg_t;
+
+static int
+png_write_downscaled_row(void *arg_, byte *row, int y)
+{
+    png_write_row_arg_t *arg = (png_write_row_arg_t *)arg_;
+
+#ifdef CLUSTER
+    row[arg->end] &= arg->mask;
+#endif
+    png_write_rows(arg->png_ptr, &row, 1);
+    return 0;
+}
+
 static int
 do_png_print_page(gx_device_png * pdev, gp_file * file, bool monod)
 {
-    gs_memory_t *mem = pdev->memory;
-    int raster = gdev_prn_raster(pdev);
     gx_downscaler_t ds;
 
     /* PNG structures */
-    byte *row = gs_alloc_bytes(mem, raster, "png raster buffer");
     png_struct *png_ptr =
         png_create_write_struct_2(PNG_LIBPNG_VER_STRING, NULL, NULL, NULL, pdev->memory, gdevpng_malloc, gdevpng_free);
     png_info *info_ptr = png_create_info_struct(png_ptr);
     int depth = pdev->color_info.depth;
-    int y;
     int code;			/* return code */
     char software_key[80];
     char software_text[256];
@@ -518,7 +534,7 @@ do_png_print_page(gx_device_png * pdev, gp_file * file, bool monod)
         depth = 1;
     }
 
-    if (row == 0 || png_ptr == 0 || info_ptr == 0) {
+    if (png_ptr == 0 || info_ptr == 0) {
         code = gs_note_error(gs_error_VMerror);
         goto done;
     }
@@ -611,7 +627,7 @@ do_png_print_page(gx_device_png * pdev, gp_file * file, bool monod)
         palettep = palette;
 #else
         palettep =
-            (void *)gs_alloc_bytes(mem, 256 * sizeof(png_color),
+            (void *)gs_alloc_bytes(pdev->memory, 256 * sizeof(png_color),
                                    "png palette");
         if (palettep == 0) {
             code = gs_note_error(gs_error_VMerror);
@@ -757,23 +773,20 @@ do_png_print_page(gx_device_png * pdev, gp_file * file, bool monod)
                               depth/dst_bpc, &pdev->downscale, NULL, 0);
     if (code >= 0)
     {
+        png_write_row_arg_t arg;
 #ifdef CLUSTER
         int bitlen = width*dst_bpc;
-        int end = bitlen>>3;
-        int mask = 255>>(bitlen&7);
+
+        arg.end = bitlen>>3;
+        arg.mask = 255>>(bitlen&7);
         if (bitlen & 7)
-            mask = ~mask;
+            arg.mask = ~arg.mask;
         else
-            end--;
+            arg.end--;
 #endif
         /* Write the contents of the image. */
-        for (y = 0; y < height; y++) {
-            gx_downscaler_getbits(&ds, row, y);
-#ifdef CLUSTER
-            row[end] &= mask;
-#endif
-            png_write_rows(png_ptr, &row, 1);
-        }
+        arg.png_ptr = png_ptr;
+        code = gx_downscaler_process_rows(&ds, height, png_write_downscaled_row, &arg);
         gx_downscaler_fin(&ds);
     }
 
@@ -783,13 +796,12 @@ do_png_print_page(gx_device_png * pdev, gp_file * file, bool monod)
 #if PNG_LIBPNG_VER_MINOR >= 5
 #else
     /* if you alloced the palette, free it here */
-    gs_free_object(mem, palettep, "png palette");
+    gs_free_object(pdev->memory, palettep, "png palette");
 #endif
 
   done:
     /* free the structures */
     png_destroy_write_struct(&png_ptr, &info_ptr);
-    gs_free_object(mem, row, "png raster buffer");
 
     return code;
 }
@@ -508,6 +508,12 @@ static int tiff_chunky_post_cm(void  *arg, byte **dst, byte **src, int w, int h,
     return 0;
 }
 
+static int
+tiff_write_downscaled_row(void *arg, byte *data, int row)
+{
+    return TIFFWriteScanline((TIFF *)arg, data, row, 0);
+}
+
 /* Special version, called with 8 bit grey input to be downsampled to 1bpp
  * output. */
 int
@@ -517,10 +523,6 @@ tiff_downscale_and_print_page(gx_device_printer *dev, TIFF *tif,
 {
     gx_device_tiff *const tfdev = (gx_device_tiff *)dev;
     int code = 0;
-    byte *data = NULL;
-    int size = gdev_mem_bytes_per_scan_line((gx_device *)dev);
-    int max_size = max(size, TIFFScanlineSize(tif));
-    int row;
     int factor = params->downscale_factor;
     int height = dev->height/factor;
     gx_downscaler_t ds;
@@ -545,27 +547,12 @@ tiff_downscale_and_print_page(gx_device_printer *dev, TIFF *tif,
     if (code < 0)
         return code;
 
-    data = gs_alloc_bytes(dev->memory, max_size, "tiff_print_page(data)");
-    if (data == NULL) {
-        gx_downscaler_fin(&ds);
-        return_error(gs_error_VMerror);
-    }
-
-    for (row = 0; row < height && code >= 0; row++) {
-        code = gx_downscaler_getbits(&ds, data, row);
-        if (code < 0)
-            break;
-
-        code = TIFFWriteScanline(tif, data, row, 0);
-        if (code < 0)
-            break;
-    }
+    code = gx_downscaler_process_rows(&ds, height, tiff_write_downscaled_row, tif);
 
     if (code >= 0)
         code = TIFFWriteDirectory(tif);
 
     gx_downscaler_fin(&ds);
-    gs_free_object(dev->memory, data, "tiff_print_page(data)");
 
     return code;
 }
@@ -60,6 +60,8 @@ typedef struct ps_interp_instance_s {
     gs_memory_t  *memory;
     uint          bytes_fed;
     gs_lib_ctx_t *psapi_instance;
+    bool          job_limited;  /* heap limit lowered for --job-memory */
+    size_t        saved_limit;
 } ps_interp_instance_t;
 
 static int
@@ -337,6 +339,7 @@ ps_impl_allocate_interp_instance(pl_interp_implementation_t *impl, gs_memory_t *
 
     psi->memory = mem;
     psi->bytes_fed = 0;
+    psi->job_limited = false;
     psi->psapi_instance = gs_lib_ctx_get_interp_instance(mem);
     code = psapi_new_instance(&psi->psapi_instance, NULL);
     if (code < 0) {
@@ -413,9 +416,23 @@ ps_impl_init_job(pl_interp_implementation_t *impl,
                  gx_device                  *device)
 {
     ps_interp_instance_t *psi = (ps_interp_instance_t *)impl->interp_client_data;
+    size_t job_memory = pl_main_get_job_memory(psi->memory);
     int exit_code;
     int code;
 
+    /* The PostScript interpreter has a heap of its own, rather than using
+     * the one that pl_main_serve_jobs limits, so apply any --job-memory
+     * limit to it here, for as long as the job runs in this interpreter. */
+    if (job_memory > 0 && !psi->job_limited) {
+        gs_malloc_memory_t *heap = (gs_malloc_memory_t *)psi->psapi_instance->memory;
+
+        if (heap->used + job_memory < heap->limit) {
+            psi->saved_limit = heap->limit;
+            heap->limit = heap->used + job_memory;
+            psi->job_limited = true;
+        }
+    }
+
     /* Any error after here *must* reset the device to null */
     code = psapi_set_device(psi->psapi_instance, device);
 
@@ -650,8 +667,13 @@ static int
 ps_impl_dnit_job(pl_interp_implementation_t *impl)
 {
     ps_interp_instance_t *psi = (ps_interp_instance_t *)impl->interp_client_data;
+    int code = psapi_set_device(psi->psapi_instance, NULL);
 
-    return psapi_set_device(psi->psapi_instance, NULL);
+    if (psi->job_limited) {
+        ((gs_malloc_memory_t *)psi->psapi_instance->memory)->limit = psi->saved_limit;
+        psi->job_limited = false;
+    }
+    return code;
 }
 
 /* Deallocate a interpreter instance */
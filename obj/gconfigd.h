@@ -0,0 +1,8 @@
+#define GS_LIB_DEFAULT "/usr/local/share/ghostscript/10.05.0/Resource/Init:/usr/local/share/ghostscript/10.05.0/lib:/usr/local/share/ghostscript/10.05.0/Resource/Font:/usr/local/share/ghostscript/fonts:/usr/local/share/fonts/default/ghostscript:/usr/local/share/fonts/default/Type1:/usr/local/share/fonts/default/TrueType:/usr/lib/DPS/outline/base:/usr/openwin/lib/X11/fonts/Type1:/usr/openwin/lib/X11/fonts/TrueType"
+#define GS_DEV_DEFAULT "x11alpha bbox"
+#define GS_CACHE_DIR "~/.ghostscript/cache/"
+#define SEARCH_HERE_FIRST 0
+#define GS_DOCDIR "/usr/local/share/doc/ghostscript/10.05.0"
+#define GS_INIT "gs_init.ps"
+#define GS_REVISION 10050
+#define GS_REVISIONDATE 20240902